@@ -13,12 +13,12 @@ namespace dae
 		 */
 		static ColorRGB Lambert(float kd, const ColorRGB& cd)
 		{
-			return (cd * kd) / float(M_PI);
+			return (cd * kd) / PI;
 		}
 
 		static ColorRGB Lambert(const ColorRGB& kd, const ColorRGB& cd)
 		{
-			return (cd * kd) / float(M_PI);
+			return (cd * kd) / PI;
 		}
 
 		/**
@@ -34,7 +34,7 @@ namespace dae
 		{		
 			const Vector3 reflect{ Vector3::Reflect(n, l) };
 			const float cosine{ std::max(0.f, Vector3::Dot(reflect, v)) };
-			const float phong{ ks * pow(cosine, exp) };
+			const float phong{ ks * FastMath::Pow(cosine, exp) };
 			return ColorRGB{ phong, phong, phong };
 		}
 
@@ -49,7 +49,7 @@ namespace dae
 		{
 			const ColorRGB start { 1 - f0.r, 1 - f0.g, 1 - f0.b };
 			const float dot{ std::max(0.f, Vector3::Dot(h, v)) };
-			const float power{ powf(1 - dot, 5.f) };
+			const float power{ FastMath::PowInt<5>(1 - dot) };
 			return f0 + start * power;
 		}
 
@@ -62,9 +62,9 @@ namespace dae
 		 */
 		static float NormalDistribution_GGX(const Vector3& n, const Vector3& h, float roughness)
 		{
-			const float dotSq{ powf(std::max(0.f, Vector3::Dot(n, h)), 2.f) };
+			const float dotSq{ Square(std::max(0.f, Vector3::Dot(n, h))) };
 			const float denominator{ dotSq * ((roughness * roughness) - 1) + 1 };
-			return (roughness * roughness) / (float(M_PI) * powf(denominator, 2.f));
+			return (roughness * roughness) / (PI * Square(denominator));
 		}
 
 		/**
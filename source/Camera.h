@@ -1,5 +1,6 @@
 #pragma once
 #include <cassert>
+#include <functional>
 #include <SDL_keyboard.h>
 #include <SDL_mouse.h>
 
@@ -8,6 +9,21 @@
 
 namespace dae
 {
+	//Everything Camera::Update reads from SDL in one frame, so it can be recorded and replayed
+	struct CameraInput
+	{
+		bool moveForward{ false };
+		bool moveBackward{ false };
+		bool moveLeft{ false };
+		bool moveRight{ false };
+		bool boost{ false };
+
+		bool leftMouse{ false };
+		bool rightMouse{ false };
+		int mouseX{ 0 };
+		int mouseY{ 0 };
+	};
+
 	struct Camera
 	{
 		Camera() = default;
@@ -34,6 +50,9 @@ namespace dae
 
 		Matrix cameraToWorld{};
 
+		//Incremented whenever Update moved or rotated the camera
+		uint32_t version{ 0 };
+
 		/*void SetFov(float deltaFov)
 		{
 			fovAngle = deltaFov;
@@ -49,31 +68,65 @@ namespace dae
 			return cameraToWorld;
 		}
 
+		//Optional override of the live input (camera path recording/replay), gets the live input and returns the one to apply
+		std::function<CameraInput(const CameraInput&)> processInput{};
+
+		static CameraInput ReadInput()
+		{
+			CameraInput input{};
+
+			//Keyboard Input
+			const uint8_t* pKeyboardState = SDL_GetKeyboardState(nullptr);
+			input.moveForward = pKeyboardState[SDL_SCANCODE_W] || pKeyboardState[SDL_SCANCODE_UP];
+			input.moveBackward = pKeyboardState[SDL_SCANCODE_S] || pKeyboardState[SDL_SCANCODE_DOWN];
+			input.moveLeft = pKeyboardState[SDL_SCANCODE_A] || pKeyboardState[SDL_SCANCODE_LEFT];
+			input.moveRight = pKeyboardState[SDL_SCANCODE_D] || pKeyboardState[SDL_SCANCODE_RIGHT];
+			input.boost = pKeyboardState[SDL_SCANCODE_LSHIFT] || pKeyboardState[SDL_SCANCODE_RSHIFT];
+
+			//Mouse Input
+			const uint32_t mouseState = SDL_GetRelativeMouseState(&input.mouseX, &input.mouseY);
+			input.leftMouse = (mouseState & SDL_BUTTON_LMASK) != 0;
+			input.rightMouse = (mouseState & SDL_BUTTON_RMASK) != 0;
+
+			return input;
+		}
+
 		void Update(Timer* pTimer)
 		{
+			CameraInput input{ ReadInput() };
+			if (processInput)
+				input = processInput(input);
+
+			ApplyInput(input, pTimer->GetElapsed());
+		}
+
+		void ApplyInput(const CameraInput& input, float deltaTime)
+		{
+			const Vector3 previousOrigin{ origin };
+			const float previousPitch{ totalPitch };
+			const float previousYaw{ totalYaw };
+
 			moveFactor = 1.f;
 
-			const float deltaTime{ pTimer->GetElapsed() };
 			//Keyboard Input
-			const uint8_t* pKeyboardState = SDL_GetKeyboardState(nullptr);
-			if (pKeyboardState[SDL_SCANCODE_W] || pKeyboardState[SDL_SCANCODE_UP])
+			if (input.moveForward)
 				origin.z += moveFactor;
-			if (pKeyboardState[SDL_SCANCODE_S] || pKeyboardState[SDL_SCANCODE_DOWN])
+			if (input.moveBackward)
 				origin.z -= moveFactor;
-			if (pKeyboardState[SDL_SCANCODE_A] || pKeyboardState[SDL_SCANCODE_LEFT])
+			if (input.moveLeft)
 				origin.x -= moveFactor;
-			if (pKeyboardState[SDL_SCANCODE_D] || pKeyboardState[SDL_SCANCODE_RIGHT])
+			if (input.moveRight)
 				origin.x += moveFactor;
 
 			//Mouse Input
-			int mouseX{}, mouseY{};
-			const uint32_t mouseState = SDL_GetRelativeMouseState(&mouseX, &mouseY);
-			if ((mouseState & SDL_BUTTON_LMASK) != 0)
+			const int mouseX{ input.mouseX };
+			const int mouseY{ input.mouseY };
+			if (input.leftMouse)
 			{
-				if (pKeyboardState[SDL_SCANCODE_LSHIFT] || pKeyboardState[SDL_SCANCODE_RSHIFT])
+				if (input.boost)
 					moveFactor += 4.f;
 
-				if ((mouseState & SDL_BUTTON_RMASK) != 0)
+				if (input.rightMouse)
 				{
 					if (mouseY < 0)
 						origin.y += moveFactor;
@@ -92,7 +145,7 @@ namespace dae
 			}
 			else 
 			{
-				if ((mouseState & SDL_BUTTON_RMASK) != 0)
+				if (input.rightMouse)
 				{
 					totalPitch -= mouseY * deltaTime;
 					totalYaw -= mouseX * deltaTime;
@@ -101,6 +154,10 @@ namespace dae
 			const Matrix rotation{ Matrix::CreateRotation(totalPitch, totalYaw, 0.f) };
 			forward = rotation.TransformVector(Vector3::UnitZ);
 			forward.Normalize();
+
+			if (origin.x != previousOrigin.x || origin.y != previousOrigin.y || origin.z != previousOrigin.z
+				|| totalPitch != previousPitch || totalYaw != previousYaw)
+				++version;
 		}
 	};
 }
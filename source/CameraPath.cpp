@@ -0,0 +1,105 @@
+#include "CameraPath.h"
+
+#include <fstream>
+
+using namespace dae;
+
+void CameraPath::StartRecording(Camera& camera)
+{
+	m_Mode = Mode::Recording;
+	m_Inputs.clear();
+
+	m_StartOrigin = camera.origin;
+	m_StartPitch = camera.totalPitch;
+	m_StartYaw = camera.totalYaw;
+
+	camera.processInput = [this](const CameraInput& liveInput) { return Process(liveInput); };
+}
+
+void CameraPath::StartReplay(Camera& camera)
+{
+	m_Mode = Mode::Replaying;
+	m_ReplayIndex = 0;
+
+	camera.origin = m_StartOrigin;
+	camera.totalPitch = m_StartPitch;
+	camera.totalYaw = m_StartYaw;
+	++camera.version;
+
+	camera.processInput = [this](const CameraInput& liveInput) { return Process(liveInput); };
+}
+
+void CameraPath::Stop(Camera& camera)
+{
+	m_Mode = Mode::Off;
+	camera.processInput = nullptr;
+}
+
+CameraInput CameraPath::Process(const CameraInput& liveInput)
+{
+	switch (m_Mode)
+	{
+	case Mode::Recording:
+		m_Inputs.emplace_back(liveInput);
+		return liveInput;
+
+	case Mode::Replaying:
+		//Live input is ignored, after the last frame the camera stands still
+		if (m_ReplayIndex < m_Inputs.size())
+			return m_Inputs[m_ReplayIndex++];
+		return CameraInput{};
+
+	case Mode::Off:
+		break;
+	}
+	return liveInput;
+}
+
+bool CameraPath::Save(const std::string& filename) const
+{
+	std::ofstream file(filename);
+	if (!file)
+		return false;
+
+	//Text format: start state, then one line per frame
+	file << m_StartOrigin.x << " " << m_StartOrigin.y << " " << m_StartOrigin.z << " "
+		<< m_StartPitch << " " << m_StartYaw << "\n";
+	file << m_Inputs.size() << "\n";
+	for (const CameraInput& input : m_Inputs)
+	{
+		file << input.moveForward << " " << input.moveBackward << " " << input.moveLeft << " " << input.moveRight << " "
+			<< input.boost << " " << input.leftMouse << " " << input.rightMouse << " "
+			<< input.mouseX << " " << input.mouseY << "\n";
+	}
+
+	return bool(file);
+}
+
+bool CameraPath::Load(const std::string& filename)
+{
+	std::ifstream file(filename);
+	if (!file)
+		return false;
+
+	size_t numFrames{};
+	file >> m_StartOrigin.x >> m_StartOrigin.y >> m_StartOrigin.z >> m_StartPitch >> m_StartYaw;
+	file >> numFrames;
+	if (!file)
+		return false;
+
+	m_Inputs.clear();
+	m_Inputs.reserve(numFrames);
+	for (size_t i{ 0 }; i < numFrames; ++i)
+	{
+		CameraInput input{};
+		file >> input.moveForward >> input.moveBackward >> input.moveLeft >> input.moveRight
+			>> input.boost >> input.leftMouse >> input.rightMouse
+			>> input.mouseX >> input.mouseY;
+		if (!file)
+			return false;
+
+		m_Inputs.emplace_back(input);
+	}
+
+	return true;
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <string>
+#include <vector>
+
+#include "Camera.h"
+
+namespace dae
+{
+	//Records the per-frame camera input of a session and replays it, together with a fixed time step
+	//every run then traces exactly the same camera positions (reproducible benchmarks)
+	class CameraPath final
+	{
+	public:
+		enum class Mode
+		{
+			Off,
+			Recording,
+			Replaying
+		};
+
+		CameraPath() = default;
+		~CameraPath() = default;
+
+		CameraPath(const CameraPath&) = delete;
+		CameraPath(CameraPath&&) noexcept = delete;
+		CameraPath& operator=(const CameraPath&) = delete;
+		CameraPath& operator=(CameraPath&&) noexcept = delete;
+
+		//Hooks the path into the camera input and remembers the start state
+		void StartRecording(Camera& camera);
+		//Resets the camera to the recorded start state and feeds it the recorded input
+		void StartReplay(Camera& camera);
+		void Stop(Camera& camera);
+
+		bool Save(const std::string& filename) const;
+		bool Load(const std::string& filename);
+
+		Mode GetMode() const { return m_Mode; }
+		size_t GetNumFrames() const { return m_Inputs.size(); }
+		bool IsReplayFinished() const { return m_Mode == Mode::Replaying && m_ReplayIndex >= m_Inputs.size(); }
+
+	private:
+		Mode m_Mode{ Mode::Off };
+
+		Vector3 m_StartOrigin{};
+		float m_StartPitch{ 0.f };
+		float m_StartYaw{ 0.f };
+
+		std::vector<CameraInput> m_Inputs{};
+		size_t m_ReplayIndex{ 0 };
+
+		CameraInput Process(const CameraInput& liveInput);
+	};
+}
@@ -0,0 +1,120 @@
+#include "CameraRayTable.h"
+
+#include <xmmintrin.h> //SSE
+
+using namespace dae;
+
+void CameraRayTable::Update(int width, int height, float fov, float aspectRatio, const Vector3& right, const Vector3& up, const Vector3& forward)
+{
+	bool isRotationNeeded{ false };
+	if (width != m_Width || height != m_Height || fov != m_Fov || aspectRatio != m_AspectRatio)
+	{
+		m_Width = width;
+		m_Height = height;
+		m_Fov = fov;
+		m_AspectRatio = aspectRatio;
+		BuildCameraSpace();
+		isRotationNeeded = true;
+	}
+
+	const auto isSame = [](const Vector3& a, const Vector3& b) { return a.x == b.x && a.y == b.y && a.z == b.z; };
+	if (isRotationNeeded || !isSame(right, m_Right) || !isSame(up, m_Up) || !isSame(forward, m_Forward))
+	{
+		m_Right = right;
+		m_Up = up;
+		m_Forward = forward;
+		RotateToWorld();
+	}
+}
+
+void CameraRayTable::BuildCameraSpace()
+{
+	const size_t numPixels{ size_t(m_Width) * m_Height };
+	m_CameraX.resize(numPixels);
+	m_CameraY.resize(numPixels);
+	m_CameraZ.resize(numPixels);
+	m_WorldX.resize(numPixels);
+	m_WorldY.resize(numPixels);
+	m_WorldZ.resize(numPixels);
+
+	//Same mapping as the per pixel setup it replaces: x = (2 * (px + 0.5) / width - 1) * aspectRatio * fov
+	const float scaleX{ 2.f * m_AspectRatio * m_Fov / float(m_Width) };
+	const float scaleY{ 2.f * m_Fov / float(m_Height) };
+	for (int py{ 0 }; py < m_Height; ++py)
+	{
+		const float y{ m_Fov - (float(py) + 0.5f) * scaleY };
+		for (int px{ 0 }; px < m_Width; ++px)
+		{
+			const float x{ (float(px) + 0.5f) * scaleX - m_AspectRatio * m_Fov };
+			const float invLength{ 1.f / sqrtf(x * x + y * y + 1.f) };
+
+			const size_t pixelIdx{ size_t(py) * m_Width + px };
+			m_CameraX[pixelIdx] = x * invLength;
+			m_CameraY[pixelIdx] = y * invLength;
+			m_CameraZ[pixelIdx] = invLength;
+		}
+	}
+
+	m_SpreadAngle = atanf(scaleY);
+}
+
+float CameraRayTable::GetFootprint(const Vector3& direction, const Vector3& normal, float t) const
+{
+	//On the z = 1 plane the direction changes by exactly one pixel step per pixel
+	const Vector3 planeDirection{ direction / std::max(Vector3::Dot(direction, m_Forward), FLT_EPSILON) };
+	const float sqrLength{ Vector3::Dot(planeDirection, planeDirection) };
+	const float invLengthCubed{ 1.f / (sqrLength * sqrtf(sqrLength)) };
+
+	//Grazing hits get a large but finite footprint
+	const float dotDirectionNormal{ Vector3::Dot(direction, normal) };
+	const float safeDot{ std::abs(dotDirectionNormal) < 1e-3f ? copysignf(1e-3f, dotDirectionNormal) : dotDirectionNormal };
+
+	float footprint{ 0.f };
+	for (const Vector3& pixelStep : { m_PixelStepX, m_PixelStepY })
+	{
+		//Derivative of the normalized direction, then of the hit point on the tangent plane
+		const Vector3 directionDerivative{ (pixelStep * sqrLength - planeDirection * Vector3::Dot(planeDirection, pixelStep)) * invLengthCubed };
+		const Vector3 positionDerivative{ directionDerivative * t - direction * (t * Vector3::Dot(directionDerivative, normal) / safeDot) };
+		footprint = std::max(footprint, positionDerivative.Magnitude());
+	}
+	return footprint;
+}
+
+void CameraRayTable::RotateToWorld()
+{
+	const size_t numPixels{ m_CameraX.size() };
+	const float* pCameraX{ m_CameraX.data() };
+	const float* pCameraY{ m_CameraY.data() };
+	const float* pCameraZ{ m_CameraZ.data() };
+	float* pWorldX{ m_WorldX.data() };
+	float* pWorldY{ m_WorldY.data() };
+	float* pWorldZ{ m_WorldZ.data() };
+
+	//world = x * right + y * up + z * forward, 4 pixels per iteration
+	const __m128 rightX{ _mm_set1_ps(m_Right.x) }, rightY{ _mm_set1_ps(m_Right.y) }, rightZ{ _mm_set1_ps(m_Right.z) };
+	const __m128 upX{ _mm_set1_ps(m_Up.x) }, upY{ _mm_set1_ps(m_Up.y) }, upZ{ _mm_set1_ps(m_Up.z) };
+	const __m128 forwardX{ _mm_set1_ps(m_Forward.x) }, forwardY{ _mm_set1_ps(m_Forward.y) }, forwardZ{ _mm_set1_ps(m_Forward.z) };
+
+	size_t i{ 0 };
+	for (; i + 4 <= numPixels; i += 4)
+	{
+		const __m128 x{ _mm_loadu_ps(pCameraX + i) };
+		const __m128 y{ _mm_loadu_ps(pCameraY + i) };
+		const __m128 z{ _mm_loadu_ps(pCameraZ + i) };
+
+		_mm_storeu_ps(pWorldX + i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, rightX), _mm_mul_ps(y, upX)), _mm_mul_ps(z, forwardX)));
+		_mm_storeu_ps(pWorldY + i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, rightY), _mm_mul_ps(y, upY)), _mm_mul_ps(z, forwardY)));
+		_mm_storeu_ps(pWorldZ + i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, rightZ), _mm_mul_ps(y, upZ)), _mm_mul_ps(z, forwardZ)));
+	}
+
+	for (; i < numPixels; ++i)
+	{
+		pWorldX[i] = pCameraX[i] * m_Right.x + pCameraY[i] * m_Up.x + pCameraZ[i] * m_Forward.x;
+		pWorldY[i] = pCameraX[i] * m_Right.y + pCameraY[i] * m_Up.y + pCameraZ[i] * m_Forward.y;
+		pWorldZ[i] = pCameraX[i] * m_Right.z + pCameraY[i] * m_Up.z + pCameraZ[i] * m_Forward.z;
+	}
+
+	//Jittered samples offset the center direction on the z = 1 plane
+	m_PixelStepX = m_Right * (2.f * m_AspectRatio * m_Fov / float(m_Width));
+	m_PixelStepY = m_Up * (-2.f * m_Fov / float(m_Height));
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "Math.h"
+
+namespace dae
+{
+	//Primary ray directions of every pixel center, stored SoA.
+	//Camera space directions only depend on the resolution and the fov, they are rotated into world space
+	//in bulk when the orientation changes. Moving the camera origin keeps both tables untouched.
+	class CameraRayTable final
+	{
+	public:
+		CameraRayTable() = default;
+		~CameraRayTable() = default;
+
+		CameraRayTable(const CameraRayTable&) = delete;
+		CameraRayTable(CameraRayTable&&) noexcept = delete;
+		CameraRayTable& operator=(const CameraRayTable&) = delete;
+		CameraRayTable& operator=(CameraRayTable&&) noexcept = delete;
+
+		/**
+		 * \brief Rebuilds whatever is out of date, call once per frame before the pixels are traced
+		 * \param fov tan(fovAngle / 2), as Camera::fov
+		 * \param right, up, forward camera basis (rows of cameraToWorld)
+		 */
+		void Update(int width, int height, float fov, float aspectRatio, const Vector3& right, const Vector3& up, const Vector3& forward);
+
+		//Normalized world direction through the center of the pixel
+		Vector3 GetDirection(uint32_t pixelIdx) const
+		{
+			return { m_WorldX[pixelIdx], m_WorldY[pixelIdx], m_WorldZ[pixelIdx] };
+		}
+
+		//Normalized world direction through (px + jitterX, py + jitterY), jitter in [0, 1)
+		Vector3 GetJitteredDirection(uint32_t pixelIdx, float jitterX, float jitterY) const
+		{
+			//Back to the z = 1 plane where a pixel step is constant, then offset from the center
+			const float invCameraZ{ 1.f / m_CameraZ[pixelIdx] };
+			const Vector3 direction{
+				GetDirection(pixelIdx) * invCameraZ + m_PixelStepX * (jitterX - 0.5f) + m_PixelStepY * (jitterY - 0.5f) };
+			return direction.Normalized();
+		}
+
+		//World space width of the pixel footprint where a primary ray along direction hits a surface at distance t,
+		//ray differentials transferred to the tangent plane (Igehy 1999)
+		float GetFootprint(const Vector3& direction, const Vector3& normal, float t) const;
+		//Angle between neighbouring pixel rays, secondary rays widen their footprint like a cone with this angle
+		float GetSpreadAngle() const { return m_SpreadAngle; }
+
+	private:
+		int m_Width{ 0 };
+		int m_Height{ 0 };
+		float m_Fov{ 0.f };
+		float m_AspectRatio{ 0.f };
+		Vector3 m_Right{};
+		Vector3 m_Up{};
+		Vector3 m_Forward{};
+
+		//World space offset of one pixel on the z = 1 plane
+		Vector3 m_PixelStepX{};
+		Vector3 m_PixelStepY{};
+		float m_SpreadAngle{ 0.f };
+
+		std::vector<float> m_CameraX{};
+		std::vector<float> m_CameraY{};
+		std::vector<float> m_CameraZ{};
+		std::vector<float> m_WorldX{};
+		std::vector<float> m_WorldY{};
+		std::vector<float> m_WorldZ{};
+
+		void BuildCameraSpace();
+		void RotateToWorld();
+	};
+}
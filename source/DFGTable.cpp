@@ -0,0 +1,98 @@
+#include "DFGTable.h"
+
+#include <algorithm>
+
+#include "BRDFs.h"
+#include "Sampling.h"
+
+using namespace dae;
+
+namespace
+{
+	//Van der Corput radical inverse, with i / n the Hammersley point set
+	float RadicalInverse(uint32_t bits)
+	{
+		bits = (bits << 16u) | (bits >> 16u);
+		bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+		bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+		bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+		bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+		return float(bits) * 2.3283064365386963e-10f;
+	}
+
+	//Texel centers, the lookup clamps outside of them
+	float GetTexelCenter(int index)
+	{
+		return (float(index) + 0.5f) / float(DFGTable::SIZE);
+	}
+}
+
+const DFGTable& DFGTable::Get()
+{
+	static const DFGTable table{};
+	return table;
+}
+
+DFGTable::DFGTable(int numSamples)
+{
+	m_Scale.resize(size_t(SIZE) * SIZE);
+	m_Bias.resize(size_t(SIZE) * SIZE);
+	for (int y{ 0 }; y < SIZE; ++y)
+	{
+		for (int x{ 0 }; x < SIZE; ++x)
+			Integrate(GetTexelCenter(x), GetTexelCenter(y), numSamples, m_Scale[size_t(y) * SIZE + x], m_Bias[size_t(y) * SIZE + x]);
+	}
+}
+
+void DFGTable::Lookup(float dotNormalView, float roughness, float& scale, float& bias) const
+{
+	const float x{ std::clamp(dotNormalView * float(SIZE) - 0.5f, 0.f, float(SIZE - 1)) };
+	const float y{ std::clamp(roughness * float(SIZE) - 0.5f, 0.f, float(SIZE - 1)) };
+	const int x0{ std::min(int(x), SIZE - 2) };
+	const int y0{ std::min(int(y), SIZE - 2) };
+	const float fx{ x - float(x0) };
+	const float fy{ y - float(y0) };
+
+	const auto bilinear = [&](const std::vector<float>& table)
+		{
+			const float* pRow0{ table.data() + size_t(y0) * SIZE + x0 };
+			const float* pRow1{ pRow0 + SIZE };
+			const float top{ pRow0[0] + (pRow0[1] - pRow0[0]) * fx };
+			const float bottom{ pRow1[0] + (pRow1[1] - pRow1[0]) * fx };
+			return top + (bottom - top) * fy;
+		};
+	scale = bilinear(m_Scale);
+	bias = bilinear(m_Bias);
+}
+
+void DFGTable::Integrate(float dotNormalView, float roughness, int numSamples, float& scale, float& bias)
+{
+	//Tangent space, the lobe only depends on the angle between view and normal
+	const Vector3 normal{ 0.f, 0.f, 1.f };
+	const float cosView{ std::max(dotNormalView, 1e-4f) };
+	const Vector3 view{ sqrtf(1.f - cosView * cosView), 0.f, cosView };
+	const float alpha{ roughness * roughness };
+
+	double sumScale{ 0.0 };
+	double sumBias{ 0.0 };
+	for (int i{ 0 }; i < numSamples; ++i)
+	{
+		const Vector3 halfVector{ Sampling::GGXSampleHalfVector(normal, alpha, (float(i) + 0.5f) / float(numSamples), RadicalInverse(uint32_t(i))) };
+		const Vector3 light{ Vector3::Reflect(-view, halfVector) };
+		const float dotNormalLight{ light.z };
+		if (dotNormalLight <= 0.f)
+			continue;
+
+		//f * cos / pdf with pdf = D * cos(h) / (4 * dot(v, h)), D cancels
+		const float dotViewHalf{ std::max(0.f, Vector3::Dot(view, halfVector)) };
+		const float dotNormalHalf{ std::max(halfVector.z, 1e-6f) };
+		const float visibility{ BRDF::GeometryFunction_Smith(normal, view, light, alpha) * dotViewHalf / (dotNormalHalf * cosView) };
+		const float fresnelWeight{ powf(1.f - dotViewHalf, 5.f) };
+
+		sumScale += (1.f - fresnelWeight) * visibility;
+		sumBias += fresnelWeight * visibility;
+	}
+
+	scale = float(sumScale / numSamples);
+	bias = float(sumBias / numSamples);
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <vector>
+
+namespace dae
+{
+	//Split-sum DFG table (Karis 2013) of the Cook-Torrance specular lobe: for a view angle and roughness the
+	//directional albedo of the GGX lobe is f0 * scale + bias. Integrated once with the same D and G terms the
+	//materials shade with, so the table matches BRDF::NormalDistribution_GGX and BRDF::GeometryFunction_Smith.
+	class DFGTable final
+	{
+	public:
+		static constexpr int SIZE{ 32 };
+
+		//Shared table, built on first use (thread safe)
+		static const DFGTable& Get();
+
+		explicit DFGTable(int numSamples = 1024);
+		~DFGTable() = default;
+
+		DFGTable(const DFGTable&) = delete;
+		DFGTable(DFGTable&&) noexcept = delete;
+		DFGTable& operator=(const DFGTable&) = delete;
+		DFGTable& operator=(DFGTable&&) noexcept = delete;
+
+		/**
+		 * \brief Bilinear lookup
+		 * \param dotNormalView cosine of the view angle, clamped to [0, 1]
+		 * \param roughness perceptual roughness (alpha = roughness^2), clamped to [0, 1]
+		 */
+		void Lookup(float dotNormalView, float roughness, float& scale, float& bias) const;
+
+		//Importance sampled integral of a single entry, what the table stores at its texel centers
+		static void Integrate(float dotNormalView, float roughness, int numSamples, float& scale, float& bias);
+
+	private:
+		std::vector<float> m_Scale{}; //SIZE x SIZE, rows are roughness, columns the view cosine
+		std::vector<float> m_Bias{};
+	};
+}
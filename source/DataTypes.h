@@ -19,6 +19,7 @@ namespace dae
 	{
 		Vector3 origin{};
 		Vector3 normal{};
+		float uvScale{ 1.f }; //world units per texture repeat
 
 		unsigned char materialIndex{ 0 };
 	};
@@ -76,13 +77,12 @@ namespace dae
 		std::vector<Vector3> positions{};
 		std::vector<Vector3> normals{};
 		std::vector<int> indices{};
+		std::vector<float> texCoords{}; //optional, u and v per position, barycentrics are used without them
 		unsigned char materialIndex{};
 
 		TriangleCullMode cullMode{TriangleCullMode::BackFaceCulling};
 
-		Matrix rotationTransform{};
-		Matrix translationTransform{};
-		Matrix scaleTransform{};
+		Transform transform{};
 
 		Vector3 minAABB{};
 		Vector3 maxAABB{};
@@ -93,19 +93,24 @@ namespace dae
 		std::vector<Vector3> transformedPositions{};
 		std::vector<Vector3> transformedNormals{};
 
+		//Dirty tracking: positions/normals/indices changed since the last Update (object space AABB is stale)
+		bool isGeometryDirty{ true };
+		//Transform version the transformed data was last built with
+		uint32_t transformedVersion{ 0 };
+
 		void Translate(const Vector3& translation)
 		{
-			translationTransform = Matrix::CreateTranslation(translation);
+			transform.SetTranslation(translation);
 		}
 
 		void RotateY(float yaw)
 		{
-			rotationTransform = Matrix::CreateRotationY(yaw);
+			transform.SetRotationY(yaw);
 		}
 
 		void Scale(const Vector3& scale)
 		{
-			scaleTransform = Matrix::CreateScale(scale);
+			transform.SetScale(scale);
 		}
 
 		void UpdateAABB()
@@ -123,7 +128,7 @@ namespace dae
 			}
 		}
 
-		void UpdateTransformedAABB(const Matrix& finalTransform)
+		void UpdateTransformedAABB(const AffineMatrix& finalTransform)
 		{
 			Vector3 tMinAABB = finalTransform.TransformPoint(minAABB);
 			Vector3 tMaxAABB = tMinAABB;
@@ -159,7 +164,7 @@ namespace dae
 			tMaxAABB = Vector3::Max(tAABB, tMaxAABB);
 
 			//(xmin, ymax, zmax)
-			tAABB = finalTransform.TransformPoint(minAABB.x, maxAABB.y, minAABB.z);
+			tAABB = finalTransform.TransformPoint(minAABB.x, maxAABB.y, maxAABB.z);
 			tMinAABB = Vector3::Min(tAABB, tMinAABB);
 			tMaxAABB = Vector3::Max(tAABB, tMaxAABB);
 
@@ -180,6 +185,7 @@ namespace dae
 			indices.emplace_back(++startIndex);
 
 			normals.emplace_back(triangle.normal);
+			isGeometryDirty = true;
 
 			//Not ideal, but making sure all vertices are updated
 			if(!ignoreTransformUpdate)
@@ -198,32 +204,41 @@ namespace dae
 			}
 		}
 
-		void UpdateTransforms()
+		/**
+		 * \brief Only recomputes what changed since the previous call
+		 * \return true if the transformed data (positions, normals, AABB) was rebuilt
+		 */
+		bool Update()
 		{
-			transformedPositions.clear();
-			transformedNormals.clear();
+			if (!isGeometryDirty && transformedVersion == transform.GetVersion())
+				return false;
 
-			transformedPositions.reserve(positions.size());
-			transformedNormals.reserve(normals.size());
+			if (isGeometryDirty)
+				UpdateAABB();
+
+			UpdateTransforms();
+			isGeometryDirty = false;
+			return true;
+		}
+
+		void UpdateTransforms()
+		{
+			transformedPositions.resize(positions.size());
+			transformedNormals.resize(normals.size());
+			transformedVersion = transform.GetVersion();
 
-			//Calculate Final Transform 
-			const Matrix& finalTransform{ scaleTransform * rotationTransform * translationTransform };
+			//Calculate Final Transform (cached, only rebuilt when scale/rotation/translation changed)
+			const AffineMatrix& finalTransform{ transform.GetMatrix() };
+			const AffineMatrix& normalTransform{ transform.GetNormalMatrix() };
 
 			//Transform Positions (positions > transformedPositions)
-			//...
-			for (const Vector3& p : positions)
-			{
-				Vector3 transformedP = finalTransform.TransformPoint(p);
-				transformedPositions.emplace_back(transformedP);
-			}
+			for (size_t i = 0; i < positions.size(); ++i)
+				transformedPositions[i] = finalTransform.TransformPoint(positions[i]);
 
 			//Transform Normals (normals > transformedNormals)
-			//...
-			for (const Vector3& n : normals)
-			{
-				Vector3 transformedN = rotationTransform.TransformVector(n);
-				transformedNormals.emplace_back(transformedN);
-			}
+			//inverse-transpose keeps them perpendicular under non-uniform scale
+			for (size_t i = 0; i < normals.size(); ++i)
+				transformedNormals[i] = normalTransform.TransformVector(normals[i]).Normalized();
 
 			UpdateTransformedAABB(finalTransform);
 		}
@@ -233,7 +248,11 @@ namespace dae
 	enum class LightType
 	{
 		Point,
-		Directional
+		Directional,
+		//Area lights, intensity is the emitted radiance
+		Rectangle, //centered at origin, spans +-axisU and +-axisV, emits towards direction (cross(axisU, axisV))
+		Disk, //centered at origin, radius, emits towards direction
+		Sphere //centered at origin, radius, emits in all directions
 	};
 
 	struct Light
@@ -242,8 +261,17 @@ namespace dae
 		Vector3 direction{};
 		ColorRGB color{};
 		float intensity{};
+		float influenceRadius{ FLT_MAX }; //beyond this distance the light is ignored, see LightUtils::GetInfluenceRadius
+
+		//Area lights only
+		Vector3 axisU{};
+		Vector3 axisV{};
+		float radius{};
+		uint32_t numSamples{ 1 }; //shadow rays per shading point per frame, the accumulator averages them over frames
 
 		LightType type{};
+
+		bool IsAreaLight() const { return type == LightType::Rectangle || type == LightType::Disk || type == LightType::Sphere; }
 	};
 #pragma endregion
 #pragma region MISC
@@ -264,6 +292,12 @@ namespace dae
 
 		bool didHit{ false };
 		unsigned char materialIndex{ 0 };
+
+		//Texturing
+		float u{ 0.f };
+		float v{ 0.f };
+		float uvDensity{ 0.f }; //texture coordinate units per world unit
+		float footprint{ 0.f }; //world space width of the pixel footprint (ray differentials), 0 >> finest mip
 	};
 #pragma endregion
 }
\ No newline at end of file
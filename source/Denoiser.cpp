@@ -0,0 +1,179 @@
+#include "Denoiser.h"
+
+#include <ppl.h> //parallel for
+
+using namespace dae;
+
+namespace
+{
+	//B3 spline, the 1D taps of the a-trous kernel
+	constexpr float KERNEL[3]{ 3.f / 8.f, 1.f / 4.f, 1.f / 16.f };
+	constexpr float ALBEDO_EPSILON{ 1e-3f };
+
+	//Calls function(px, py) for every pixel, tiles keep the taps of neighbouring pixels in cache
+	template<typename Function>
+	void ForEachPixelTiled(int width, int height, int tileSize, const Function& function)
+	{
+		const int numTilesX{ (width + tileSize - 1) / tileSize };
+		const int numTilesY{ (height + tileSize - 1) / tileSize };
+
+		concurrency::parallel_for(0, numTilesX * numTilesY, [&](int tileIdx)
+			{
+				const int startX{ (tileIdx % numTilesX) * tileSize };
+				const int startY{ (tileIdx / numTilesX) * tileSize };
+				const int endX{ std::min(startX + tileSize, width) };
+				const int endY{ std::min(startY + tileSize, height) };
+
+				for (int py{ startY }; py < endY; ++py)
+				{
+					for (int px{ startX }; px < endX; ++px)
+						function(px, py);
+				}
+			});
+	}
+
+	//Calls function(pixelIdx) for every pixel, one row per task, for the per pixel passes without taps
+	template<typename Function>
+	void ForEachRow(int width, int height, const Function& function)
+	{
+		concurrency::parallel_for(0, height, [&](int py)
+			{
+				const size_t rowStart{ size_t(py) * width };
+				for (size_t pixelIdx{ rowStart }; pixelIdx < rowStart + width; ++pixelIdx)
+					function(pixelIdx);
+			});
+	}
+
+	bool IsBackground(float depth)
+	{
+		return depth == FLT_MAX;
+	}
+}
+
+void Denoiser::Apply(int width, int height, const ColorRGB* pColor, const ColorRGB* pAlbedo, const Vector3* pNormals,
+	const float* pDepth, ColorRGB* pOutput)
+{
+	const size_t numPixels{ size_t(width) * height };
+	m_Illumination.resize(numPixels);
+	m_Filtered.resize(numPixels);
+	m_Variance.resize(numPixels);
+	m_FilteredVariance.resize(numPixels);
+
+	//Demodulate, only the lighting gets blurred
+	ForEachRow(width, height, [&](size_t i)
+		{
+			const ColorRGB& albedo{ pAlbedo[i] };
+			m_Illumination[i] = {
+				pColor[i].r / std::max(albedo.r, ALBEDO_EPSILON),
+				pColor[i].g / std::max(albedo.g, ALBEDO_EPSILON),
+				pColor[i].b / std::max(albedo.b, ALBEDO_EPSILON) };
+		});
+
+	EstimateVariance(width, height, pDepth);
+
+	//Ping-pong between the scratch buffers, the step size doubles every iteration
+	for (uint32_t iteration{ 0 }; iteration < m_NumIterations; ++iteration)
+	{
+		FilterIteration(width, height, 1 << iteration, pNormals, pDepth);
+		m_Illumination.swap(m_Filtered);
+		m_Variance.swap(m_FilteredVariance);
+	}
+
+	//Remodulate
+	ForEachRow(width, height, [&](size_t i)
+		{
+			const ColorRGB& albedo{ pAlbedo[i] };
+			pOutput[i] = {
+				m_Illumination[i].r * std::max(albedo.r, ALBEDO_EPSILON),
+				m_Illumination[i].g * std::max(albedo.g, ALBEDO_EPSILON),
+				m_Illumination[i].b * std::max(albedo.b, ALBEDO_EPSILON) };
+		});
+}
+
+void Denoiser::EstimateVariance(int width, int height, const float* pDepth)
+{
+	ForEachPixelTiled(width, height, m_TileSize, [&](int px, int py)
+		{
+			const size_t pixelIdx{ size_t(py) * width + px };
+			const bool isBackground{ IsBackground(pDepth[pixelIdx]) };
+
+			float sum{ 0.f };
+			float sumSquared{ 0.f };
+			float count{ 0.f };
+			for (int y{ std::max(py - 1, 0) }; y <= std::min(py + 1, height - 1); ++y)
+			{
+				for (int x{ std::max(px - 1, 0) }; x <= std::min(px + 1, width - 1); ++x)
+				{
+					const size_t sampleIdx{ size_t(y) * width + x };
+					if (IsBackground(pDepth[sampleIdx]) != isBackground)
+						continue;
+
+					const float luminance{ m_Illumination[sampleIdx].Luminance() };
+					sum += luminance;
+					sumSquared += luminance * luminance;
+					++count;
+				}
+			}
+
+			const float mean{ sum / count };
+			m_Variance[pixelIdx] = std::max(0.f, sumSquared / count - mean * mean);
+		});
+}
+
+void Denoiser::FilterIteration(int width, int height, int stepSize, const Vector3* pNormals, const float* pDepth)
+{
+	ForEachPixelTiled(width, height, m_TileSize, [&](int px, int py)
+		{
+			const size_t pixelIdx{ size_t(py) * width + px };
+			const Vector3& normal{ pNormals[pixelIdx] };
+			const float depth{ pDepth[pixelIdx] };
+			const bool isBackground{ IsBackground(depth) };
+			const float luminance{ m_Illumination[pixelIdx].Luminance() };
+			const float invColorPhi{ 1.f / (m_ColorPhi * sqrtf(m_Variance[pixelIdx]) + FLT_EPSILON) };
+
+			ColorRGB sum{};
+			float weightSum{ 0.f };
+			float varianceSum{ 0.f };
+			for (int dy{ -2 }; dy <= 2; ++dy)
+			{
+				const int y{ py + dy * stepSize };
+				if (y < 0 || y >= height)
+					continue;
+
+				for (int dx{ -2 }; dx <= 2; ++dx)
+				{
+					const int x{ px + dx * stepSize };
+					if (x < 0 || x >= width)
+						continue;
+
+					const size_t sampleIdx{ size_t(y) * width + x };
+					const float sampleDepth{ pDepth[sampleIdx] };
+					if (IsBackground(sampleDepth) != isBackground)
+						continue; //never mix geometry and background
+
+					float weight{ KERNEL[std::abs(dx)] * KERNEL[std::abs(dy)] };
+					if (!isBackground)
+					{
+						//Normal and depth (relative, scaled with the tap distance) edge-stopping
+						const float normalWeight{ powf(std::max(0.f, Vector3::Dot(normal, pNormals[sampleIdx])), m_NormalPower) };
+						const float tapDistance{ float(stepSize) * sqrtf(float(dx * dx + dy * dy)) };
+						const float depthWeight{ expf(-std::abs(depth - sampleDepth) / (m_DepthPhi * depth * tapDistance + FLT_EPSILON)) };
+						weight *= normalWeight * depthWeight;
+					}
+
+					//Luminance edge-stopping, relative to the noise level of the center pixel
+					const ColorRGB& sample{ m_Illumination[sampleIdx] };
+					weight *= expf(-std::abs(sample.Luminance() - luminance) * invColorPhi);
+
+					sum += sample * weight;
+					weightSum += weight;
+					varianceSum += weight * weight * m_Variance[sampleIdx];
+				}
+			}
+
+			//The center tap always has weight > 0, the variance shrinks the same way the filtered mean does
+			const float invWeightSum{ 1.f / weightSum };
+			m_Filtered[pixelIdx] = sum * invWeightSum;
+			m_FilteredVariance[pixelIdx] = varianceSum * invWeightSum * invWeightSum;
+		});
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "Math.h"
+
+namespace dae
+{
+	//Edge-avoiding a-trous wavelet filter (Dammertz et al. 2010) guided by albedo, normal and depth.
+	//The illumination (color / albedo) is filtered so texture and material edges stay sharp,
+	//every iteration doubles the kernel footprint while keeping 5x5 taps.
+	//Like SVGF the luminance edge-stopping is scaled by a local variance estimate, so sample noise
+	//is smoothed while real lighting edges (shadow boundaries) survive.
+	class Denoiser final
+	{
+	public:
+		Denoiser() = default;
+		~Denoiser() = default;
+
+		Denoiser(const Denoiser&) = delete;
+		Denoiser(Denoiser&&) noexcept = delete;
+		Denoiser& operator=(const Denoiser&) = delete;
+		Denoiser& operator=(Denoiser&&) noexcept = delete;
+
+		/**
+		 * \brief Filters a linear radiance image, all buffers hold width * height pixels
+		 * \param pColor per pixel average radiance
+		 * \param pAlbedo first hit albedo
+		 * \param pNormals first hit normal
+		 * \param pDepth first hit distance, FLT_MAX for background
+		 * \param pOutput filtered radiance, may be pColor (the input is only read before the first write)
+		 */
+		void Apply(int width, int height, const ColorRGB* pColor, const ColorRGB* pAlbedo, const Vector3* pNormals,
+			const float* pDepth, ColorRGB* pOutput);
+
+		void SetNumIterations(uint32_t numIterations) { m_NumIterations = numIterations; }
+		uint32_t GetNumIterations() const { return m_NumIterations; }
+
+	private:
+		uint32_t m_NumIterations{ 4 }; //kernel reaches 2^(iterations + 1) pixels
+		float m_ColorPhi{ 4.f }; //luminance difference tolerance, in standard deviations
+		float m_NormalPower{ 64.f }; //dot(n, n')^power
+		float m_DepthPhi{ 0.05f }; //relative depth difference tolerance per pixel step
+
+		int m_TileSize{ 32 };
+
+		std::vector<ColorRGB> m_Illumination{};
+		std::vector<ColorRGB> m_Filtered{};
+		std::vector<float> m_Variance{};
+		std::vector<float> m_FilteredVariance{};
+
+		//3x3 luminance variance of the demodulated input, the only estimate available at one sample per pixel
+		void EstimateVariance(int width, int height, const float* pDepth);
+		void FilterIteration(int width, int height, int stepSize, const Vector3* pNormals, const float* pDepth);
+	};
+}
@@ -0,0 +1,184 @@
+#include "EnvironmentMap.h"
+
+#include <algorithm>
+
+#include "Image.h"
+
+using namespace dae;
+
+namespace
+{
+	//Texel (x, y) covers phi in [2 pi x / width, 2 pi (x + 1) / width) and theta in [pi y / height, pi (y + 1) / height)
+	Vector3 GetDirection(float u, float v)
+	{
+		const float phi{ PI_2 * u };
+		const float theta{ PI * v };
+		const float sinTheta{ sinf(theta) };
+		return { sinTheta * cosf(phi), cosf(theta), sinTheta * sinf(phi) };
+	}
+
+	//Index of the last entry <= value, the cdf starts at 0 and ends at 1
+	size_t FindInterval(const float* pCdf, size_t size, float value)
+	{
+		const float* pUpper{ std::upper_bound(pCdf, pCdf + size, value) };
+		return std::clamp(size_t(pUpper - pCdf), size_t(1), size - 1) - 1;
+	}
+}
+
+EnvironmentMap::EnvironmentMap(int width, int height, const std::vector<ColorRGB>& texels, float intensity) :
+	m_Width(width),
+	m_Height(height),
+	m_Texels(texels)
+{
+	for (ColorRGB& texel : m_Texels)
+		texel *= intensity;
+
+	BuildDistribution();
+}
+
+EnvironmentMap* EnvironmentMap::LoadFromFile(const std::string& filename, float intensity)
+{
+	Image image{};
+	const bool isPFM{ filename.size() >= 4 && filename.compare(filename.size() - 4, 4, ".pfm") == 0 };
+	if (isPFM ? !ImageUtils::LoadPFM(filename, image) : !ImageUtils::LoadHDR(filename, image))
+		return nullptr;
+
+	std::vector<ColorRGB> texels(size_t(image.width) * image.height);
+	for (size_t i{ 0 }; i < texels.size(); ++i)
+		texels[i] = { image.radiance[i * 3 + 0], image.radiance[i * 3 + 1], image.radiance[i * 3 + 2] };
+
+	return new EnvironmentMap(image.width, image.height, texels, intensity);
+}
+
+EnvironmentMap* EnvironmentMap::CreateSky(int width, int height, const Vector3& sunDirection, const ColorRGB& sunRadiance,
+	const ColorRGB& horizonColor, const ColorRGB& zenithColor)
+{
+	//sunDirection points from the scene towards the sun, the disk is 2.5 degrees wide
+	const Vector3 toSun{ sunDirection.Normalized() };
+	const float cosSunRadius{ cosf(1.25f * TO_RADIANS) };
+
+	std::vector<ColorRGB> texels(size_t(width) * height);
+	for (int y{ 0 }; y < height; ++y)
+	{
+		for (int x{ 0 }; x < width; ++x)
+		{
+			const Vector3 direction{ GetDirection((float(x) + 0.5f) / float(width), (float(y) + 0.5f) / float(height)) };
+
+			ColorRGB color{ 0.3f * horizonColor }; //dim ground below the horizon
+			if (direction.y >= 0.f)
+				color = ColorRGB::Lerp(horizonColor, zenithColor, sqrtf(direction.y));
+			if (Vector3::Dot(direction, toSun) >= cosSunRadius)
+				color = sunRadiance;
+
+			texels[size_t(y) * width + x] = color;
+		}
+	}
+
+	return new EnvironmentMap(width, height, texels);
+}
+
+ColorRGB EnvironmentMap::GetRadiance(const Vector3& direction) const
+{
+	return m_Texels[GetTexelIndex(direction)];
+}
+
+ColorRGB EnvironmentMap::Sample(float u, float v, Vector3& direction, float& pdf) const
+{
+	pdf = 0.f;
+	if (m_Integral <= 0.f)
+		return {};
+
+	//Row from the marginal, then the column from that row's conditional, continuous inside the texel
+	const size_t row{ FindInterval(m_MarginalCdf.data(), m_MarginalCdf.size(), v) };
+	const float rowWidth{ m_MarginalCdf[row + 1] - m_MarginalCdf[row] };
+	const float rowOffset{ rowWidth > 0.f ? (v - m_MarginalCdf[row]) / rowWidth : 0.5f };
+
+	const float* pConditional{ m_ConditionalCdf.data() + row * (m_Width + 1) };
+	const size_t column{ FindInterval(pConditional, size_t(m_Width) + 1, u) };
+	const float columnWidth{ pConditional[column + 1] - pConditional[column] };
+	const float columnOffset{ columnWidth > 0.f ? (u - pConditional[column]) / columnWidth : 0.5f };
+
+	const float mapU{ (float(column) + std::clamp(columnOffset, 0.f, 0.99999f)) / float(m_Width) };
+	const float mapV{ (float(row) + std::clamp(rowOffset, 0.f, 0.99999f)) / float(m_Height) };
+	direction = GetDirection(mapU, mapV);
+
+	const size_t texelIdx{ row * m_Width + column };
+	pdf = GetTexelPdf(texelIdx, sinf(PI * mapV));
+	return m_Texels[texelIdx];
+}
+
+float EnvironmentMap::GetPdf(const Vector3& direction) const
+{
+	if (m_Integral <= 0.f)
+		return 0.f;
+
+	const float sinTheta{ sqrtf(std::max(0.f, 1.f - direction.y * direction.y)) };
+	return GetTexelPdf(GetTexelIndex(direction), sinTheta);
+}
+
+void EnvironmentMap::BuildDistribution()
+{
+	m_MarginalCdf.assign(size_t(m_Height) + 1, 0.f);
+	m_ConditionalCdf.assign((size_t(m_Width) + 1) * m_Height, 0.f);
+
+	//Weights in double, a 4k map sums millions of texels
+	std::vector<double> rowSums(m_Height, 0.0);
+	for (int y{ 0 }; y < m_Height; ++y)
+	{
+		//Rows near the poles cover less solid angle
+		const double sinTheta{ sin(PI * (double(y) + 0.5) / double(m_Height)) };
+		float* pConditional{ m_ConditionalCdf.data() + size_t(y) * (m_Width + 1) };
+
+		double sum{ 0.0 };
+		std::vector<double> prefix(size_t(m_Width) + 1, 0.0);
+		for (int x{ 0 }; x < m_Width; ++x)
+		{
+			sum += std::max(0.f, m_Texels[size_t(y) * m_Width + x].Luminance()) * sinTheta;
+			prefix[x + 1] = sum;
+		}
+
+		//Black rows are never picked by the marginal, a uniform cdf keeps them well formed
+		for (int x{ 0 }; x <= m_Width; ++x)
+			pConditional[x] = sum > 0.0 ? float(prefix[x] / sum) : float(x) / float(m_Width);
+		pConditional[m_Width] = 1.f;
+		rowSums[y] = sum;
+	}
+
+	double total{ 0.0 };
+	for (int y{ 0 }; y < m_Height; ++y)
+	{
+		total += rowSums[y];
+		m_MarginalCdf[y + 1] = float(total);
+	}
+
+	m_Integral = float(total);
+	for (int y{ 0 }; y <= m_Height; ++y)
+		m_MarginalCdf[y] = total > 0.0 ? float(double(m_MarginalCdf[y]) / total) : float(y) / float(m_Height);
+	m_MarginalCdf[m_Height] = 1.f;
+}
+
+size_t EnvironmentMap::GetTexelIndex(const Vector3& direction) const
+{
+	float u{ atan2f(direction.z, direction.x) / PI_2 };
+	if (u < 0.f)
+		u += 1.f;
+	const float v{ acosf(std::clamp(direction.y, -1.f, 1.f)) / PI };
+
+	const int x{ std::min(int(u * float(m_Width)), m_Width - 1) };
+	const int y{ std::min(int(v * float(m_Height)), m_Height - 1) };
+	return size_t(y) * m_Width + x;
+}
+
+float EnvironmentMap::GetTexelPdf(size_t texelIdx, float sinTheta) const
+{
+	if (sinTheta <= 0.f)
+		return 0.f;
+
+	//Piecewise constant over the image (texel weight / integral * number of texels), then to solid angle:
+	//d(solid angle) = 2 pi^2 sin(theta) du dv
+	const size_t row{ texelIdx / m_Width };
+	const float rowSinTheta{ sinf(PI * (float(row) + 0.5f) / float(m_Height)) };
+	const float weight{ std::max(0.f, m_Texels[texelIdx].Luminance()) * rowSinTheta };
+	const float imagePdf{ weight / m_Integral * float(m_Width) * float(m_Height) };
+	return imagePdf / (2.f * PI * PI * sinTheta);
+}
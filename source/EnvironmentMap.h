@@ -0,0 +1,59 @@
+#pragma once
+#include <string>
+#include <vector>
+
+#include "Math.h"
+
+namespace dae
+{
+	//Distant light surrounding the scene, an equirectangular (latitude-longitude) HDR image with +Y up.
+	//Texels are sampled proportional to luminance * sin(theta) by inverting a marginal CDF over the rows
+	//and a conditional CDF per row, so the bright parts (sun, windows) get most of the shadow rays.
+	class EnvironmentMap final
+	{
+	public:
+		//texels: linear RGB, rows from top (+Y) to bottom
+		EnvironmentMap(int width, int height, const std::vector<ColorRGB>& texels, float intensity = 1.f);
+		~EnvironmentMap() = default;
+
+		EnvironmentMap(const EnvironmentMap&) = delete;
+		EnvironmentMap(EnvironmentMap&&) noexcept = delete;
+		EnvironmentMap& operator=(const EnvironmentMap&) = delete;
+		EnvironmentMap& operator=(EnvironmentMap&&) noexcept = delete;
+
+		//PFM or Radiance HDR, nullptr if the file could not be read
+		static EnvironmentMap* LoadFromFile(const std::string& filename, float intensity = 1.f);
+		//Procedural sky, a horizon to zenith gradient with a small bright sun disk
+		static EnvironmentMap* CreateSky(int width, int height, const Vector3& sunDirection, const ColorRGB& sunRadiance,
+			const ColorRGB& horizonColor, const ColorRGB& zenithColor);
+
+		//Radiance arriving along -direction (direction points away from the scene)
+		ColorRGB GetRadiance(const Vector3& direction) const;
+
+		/**
+		 * \brief Importance samples a direction
+		 * \param u, v uniform samples in [0, 1)
+		 * \param pdf solid angle pdf of the direction (out), 0 if the map is black
+		 * \return radiance along the sampled direction
+		 */
+		ColorRGB Sample(float u, float v, Vector3& direction, float& pdf) const;
+		//Solid angle pdf with which Sample picks direction
+		float GetPdf(const Vector3& direction) const;
+
+		int GetWidth() const { return m_Width; }
+		int GetHeight() const { return m_Height; }
+
+	private:
+		int m_Width{};
+		int m_Height{};
+		std::vector<ColorRGB> m_Texels{};
+
+		std::vector<float> m_MarginalCdf{}; //m_Height + 1 entries
+		std::vector<float> m_ConditionalCdf{}; //m_Width + 1 entries per row
+		float m_Integral{ 0.f }; //sum of the texel weights
+
+		void BuildDistribution();
+		size_t GetTexelIndex(const Vector3& direction) const;
+		float GetTexelPdf(size_t texelIdx, float sinTheta) const;
+	};
+}
@@ -0,0 +1,234 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define FASTMATH_SSE
+#endif
+
+namespace dae
+{
+	enum class MathPrecision
+	{
+		Exact, //standard library
+		Fast //approximations below, error bounds checked by --validate-math
+	};
+
+	//Define DAE_EXACT_MATH to build the shading code with the standard library functions
+#if defined(DAE_EXACT_MATH)
+	constexpr MathPrecision MATH_PRECISION{ MathPrecision::Exact };
+#else
+	constexpr MathPrecision MATH_PRECISION{ MathPrecision::Fast };
+#endif
+
+	namespace FastMath
+	{
+		inline uint32_t FloatToBits(float value)
+		{
+			uint32_t bits{};
+			std::memcpy(&bits, &value, sizeof(bits));
+			return bits;
+		}
+
+		inline float BitsToFloat(uint32_t bits)
+		{
+			float value{};
+			std::memcpy(&value, &bits, sizeof(value));
+			return value;
+		}
+
+		//x^N by squaring, exact up to a few ulp, N is known at compile time so it unrolls to multiplications
+		template<int N>
+		constexpr float PowInt(float x)
+		{
+			if constexpr (N == 0)
+				return 1.f;
+			else if constexpr (N < 0)
+				return 1.f / PowInt<-N>(x);
+			else
+			{
+				const float half{ PowInt<N / 2>(x) };
+				if constexpr (N % 2 == 0)
+					return half * half;
+				else
+					return half * half * x;
+			}
+		}
+
+		//x^n by squaring for exponents only known at run time
+		inline float PowInt(float x, int n)
+		{
+			float base{ n < 0 ? 1.f / x : x };
+			uint32_t exponent{ uint32_t(n < 0 ? -n : n) };
+			float result{ 1.f };
+			while (exponent > 0)
+			{
+				if (exponent & 1u)
+					result *= base;
+				base *= base;
+				exponent >>= 1u;
+			}
+			return result;
+		}
+
+#pragma region Scalar
+		//1 / sqrt(x) for x > 0, hardware estimate refined by one Newton-Raphson step (relative error ~1e-6)
+		inline float RSqrtFast(float x)
+		{
+#if defined(FASTMATH_SSE)
+			const float estimate{ _mm_cvtss_f32(_mm_rsqrt_ss(_mm_set_ss(x))) };
+			return estimate * (1.5f - 0.5f * x * estimate * estimate);
+#else
+			//Bit level estimate (relative error ~2e-3), three steps to reach the same accuracy
+			float estimate{ BitsToFloat(0x5F375A86u - (FloatToBits(x) >> 1u)) };
+			estimate *= 1.5f - 0.5f * x * estimate * estimate;
+			estimate *= 1.5f - 0.5f * x * estimate * estimate;
+			return estimate * (1.5f - 0.5f * x * estimate * estimate);
+#endif
+		}
+
+		//2^x, degree 5 polynomial on the fraction (relative error ~2e-7), clamps x to [-126, 127.5) so the result stays a normal float
+		inline float Exp2Fast(float x)
+		{
+			//x = i + f with f in [-0.5, 0.5], 2^i goes straight into the exponent bits.
+			//The clamp is hit at random by Pow, it has to stay branchless (compilers turn std::min into jumps)
+#if defined(FASTMATH_SSE)
+			const __m128 clamped{ _mm_min_ss(_mm_max_ss(_mm_set_ss(x), _mm_set_ss(-126.f)), _mm_set_ss(127.4999f)) };
+			x = _mm_cvtss_f32(clamped);
+			const int integer{ _mm_cvtss_si32(clamped) }; //round to nearest
+#else
+			x = std::min(std::max(x, -126.f), 127.4999f);
+			const float shifted{ x + 0.5f };
+			const int integer{ int(shifted) - (shifted < 0.f && float(int(shifted)) != shifted ? 1 : 0) };
+#endif
+			const float f{ x - float(integer) };
+
+			//Chebyshev fit of 2^f on [-0.5, 0.5]
+			const float polynomial{ 1.00000008e+00f + f * (6.93147188e-01f + f * (2.40221075e-01f
+				+ f * (5.55035711e-02f + f * (9.67603192e-03f + f * 1.33908634e-03f)))) };
+			return polynomial * BitsToFloat(uint32_t(integer + 127) << 23u);
+		}
+
+		//log2(x) for normal x > 0, error ~1.5e-7 relative to max(1, |log2(x)|)
+		inline float Log2Fast(float x)
+		{
+			//x = m * 2^e with m in [sqrt(0.5), sqrt(2)): offsetting the bits by those of sqrt(0.5) makes the exponent field e,
+			//no compare that would mispredict on every other shading input
+			const int32_t bits{ int32_t(FloatToBits(x)) };
+			const int32_t exponent{ (bits - 0x3F3504F3) >> 23 };
+			const float mantissa{ BitsToFloat(uint32_t(bits) - (uint32_t(exponent) << 23u)) };
+
+			//log2(m) = 2 / ln(2) * atanh(t), t = (m - 1) / (m + 1) stays below 0.172
+			const float t{ (mantissa - 1.f) / (mantissa + 1.f) };
+			const float tSquared{ t * t };
+			const float series{ t * (1.f + tSquared * (1.f / 3.f + tSquared * (1.f / 5.f + tSquared * (1.f / 7.f)))) };
+			return float(exponent) + 2.88539008f * series;
+		}
+
+		//x^y for x >= 0 (x^0 = 1, 0^y = 0 otherwise), relative error ~2.5e-7 * (1 + |y * log2(x)|)
+		inline float PowFast(float x, float y)
+		{
+			if (y == 0.f)
+				return 1.f;
+			if (x <= 0.f)
+				return 0.f;
+			return Exp2Fast(y * Log2Fast(x));
+		}
+#pragma endregion
+
+#if defined(FASTMATH_SSE)
+#pragma region SSE
+		//Four lanes at a time, same algorithms and error bounds as the scalar versions
+		inline __m128 RSqrtFast(__m128 x)
+		{
+			const __m128 estimate{ _mm_rsqrt_ps(x) };
+			const __m128 estimateSquared{ _mm_mul_ps(estimate, estimate) };
+			return _mm_mul_ps(estimate, _mm_sub_ps(_mm_set1_ps(1.5f), _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(0.5f), x), estimateSquared)));
+		}
+
+		inline __m128 Exp2Fast(__m128 x)
+		{
+			x = _mm_min_ps(_mm_max_ps(x, _mm_set1_ps(-126.f)), _mm_set1_ps(127.4999f));
+
+			//Round to nearest (default rounding mode), f in [-0.5, 0.5]
+			const __m128i integer{ _mm_cvtps_epi32(x) };
+			const __m128 f{ _mm_sub_ps(x, _mm_cvtepi32_ps(integer)) };
+
+			__m128 polynomial{ _mm_set1_ps(1.33908634e-03f) };
+			polynomial = _mm_add_ps(_mm_mul_ps(polynomial, f), _mm_set1_ps(9.67603192e-03f));
+			polynomial = _mm_add_ps(_mm_mul_ps(polynomial, f), _mm_set1_ps(5.55035711e-02f));
+			polynomial = _mm_add_ps(_mm_mul_ps(polynomial, f), _mm_set1_ps(2.40221075e-01f));
+			polynomial = _mm_add_ps(_mm_mul_ps(polynomial, f), _mm_set1_ps(6.93147188e-01f));
+			polynomial = _mm_add_ps(_mm_mul_ps(polynomial, f), _mm_set1_ps(1.00000008e+00f));
+
+			const __m128 scale{ _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(integer, _mm_set1_epi32(127)), 23)) };
+			return _mm_mul_ps(polynomial, scale);
+		}
+
+		inline __m128 Log2Fast(__m128 x)
+		{
+			const __m128i bits{ _mm_castps_si128(x) };
+			const __m128i exponent{ _mm_srai_epi32(_mm_sub_epi32(bits, _mm_set1_epi32(0x3F3504F3)), 23) };
+			const __m128 mantissa{ _mm_castsi128_ps(_mm_sub_epi32(bits, _mm_slli_epi32(exponent, 23))) };
+
+			const __m128 one{ _mm_set1_ps(1.f) };
+			const __m128 t{ _mm_div_ps(_mm_sub_ps(mantissa, one), _mm_add_ps(mantissa, one)) };
+			const __m128 tSquared{ _mm_mul_ps(t, t) };
+			__m128 series{ _mm_set1_ps(1.f / 7.f) };
+			series = _mm_add_ps(_mm_mul_ps(series, tSquared), _mm_set1_ps(1.f / 5.f));
+			series = _mm_add_ps(_mm_mul_ps(series, tSquared), _mm_set1_ps(1.f / 3.f));
+			series = _mm_add_ps(_mm_mul_ps(series, tSquared), one);
+			series = _mm_mul_ps(series, t);
+
+			return _mm_add_ps(_mm_cvtepi32_ps(exponent), _mm_mul_ps(series, _mm_set1_ps(2.88539008f)));
+		}
+
+		inline __m128 PowFast(__m128 x, __m128 y)
+		{
+			const __m128 isPositive{ _mm_cmpgt_ps(x, _mm_setzero_ps()) };
+			const __m128 isZeroExponent{ _mm_cmpeq_ps(y, _mm_setzero_ps()) };
+			const __m128 power{ _mm_and_ps(isPositive, Exp2Fast(_mm_mul_ps(y, Log2Fast(x)))) };
+			return _mm_or_ps(_mm_and_ps(isZeroExponent, _mm_set1_ps(1.f)), _mm_andnot_ps(isZeroExponent, power));
+		}
+#pragma endregion
+#endif
+
+#pragma region Precision dispatch
+		//What the shading code calls, MATH_PRECISION picks the implementation at compile time
+		inline float RSqrt(float x)
+		{
+			if constexpr (MATH_PRECISION == MathPrecision::Fast)
+				return RSqrtFast(x);
+			else
+				return 1.f / sqrtf(x);
+		}
+
+		inline float Exp2(float x)
+		{
+			if constexpr (MATH_PRECISION == MathPrecision::Fast)
+				return Exp2Fast(x);
+			else
+				return exp2f(x);
+		}
+
+		inline float Log2(float x)
+		{
+			if constexpr (MATH_PRECISION == MathPrecision::Fast)
+				return Log2Fast(x);
+			else
+				return log2f(x);
+		}
+
+		inline float Pow(float x, float y)
+		{
+			if constexpr (MATH_PRECISION == MathPrecision::Fast)
+				return PowFast(x, y);
+			else
+				return powf(x, y);
+		}
+#pragma endregion
+	}
+}
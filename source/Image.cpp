@@ -0,0 +1,410 @@
+#include "Image.h"
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <fstream>
+
+namespace dae {
+namespace ImageUtils {
+
+#pragma region Helpers
+	static void WriteU16LE(std::ofstream& file, uint16_t value)
+	{
+		const char bytes[2]{ char(value & 0xFF), char(value >> 8) };
+		file.write(bytes, 2);
+	}
+
+	static void WriteU32LE(std::ofstream& file, uint32_t value)
+	{
+		const char bytes[4]{ char(value & 0xFF), char((value >> 8) & 0xFF), char((value >> 16) & 0xFF), char(value >> 24) };
+		file.write(bytes, 4);
+	}
+
+	static void AppendU32BE(std::vector<uint8_t>& buffer, uint32_t value)
+	{
+		buffer.push_back(uint8_t(value >> 24));
+		buffer.push_back(uint8_t((value >> 16) & 0xFF));
+		buffer.push_back(uint8_t((value >> 8) & 0xFF));
+		buffer.push_back(uint8_t(value & 0xFF));
+	}
+
+	static uint32_t CRC32(const uint8_t* pData, size_t size, uint32_t crc = 0)
+	{
+		static const std::array<uint32_t, 256> table{ []()
+			{
+				std::array<uint32_t, 256> result{};
+				for (uint32_t n{ 0 }; n < 256; ++n)
+				{
+					uint32_t c{ n };
+					for (int k{ 0 }; k < 8; ++k)
+						c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+					result[n] = c;
+				}
+				return result;
+			}() };
+
+		crc = ~crc;
+		for (size_t i{ 0 }; i < size; ++i)
+			crc = table[(crc ^ pData[i]) & 0xFF] ^ (crc >> 8);
+		return ~crc;
+	}
+
+	static void WritePNGChunk(std::ofstream& file, const char* type, const std::vector<uint8_t>& data)
+	{
+		std::vector<uint8_t> chunk{};
+		chunk.reserve(data.size() + 12);
+		AppendU32BE(chunk, uint32_t(data.size()));
+		chunk.insert(chunk.end(), type, type + 4);
+		chunk.insert(chunk.end(), data.begin(), data.end());
+		AppendU32BE(chunk, CRC32(chunk.data() + 4, data.size() + 4)); //crc over type + data
+
+		file.write(reinterpret_cast<const char*>(chunk.data()), chunk.size());
+	}
+
+	//Whole token as a number, false on anything malformed or out of range instead of throwing like std::stoi
+	template<typename T>
+	static bool ParseHeaderValue(const std::string& token, T& value)
+	{
+		const char* pEnd{ token.data() + token.size() };
+		const auto [pLast, error] { std::from_chars(token.data(), pEnd, value) };
+		return error == std::errc{} && pLast == pEnd;
+	}
+
+	static bool ReadPNMHeaderToken(std::ifstream& file, std::string& token)
+	{
+		file >> token;
+		while (file && !token.empty() && token[0] == '#') //skip comments
+		{
+			file.ignore(1000, '\n');
+			file >> token;
+		}
+		return bool(file);
+	}
+#pragma endregion
+
+	const char* GetExtension(ImageFormat format)
+	{
+		switch (format)
+		{
+		case ImageFormat::BMP:
+			return "bmp";
+		case ImageFormat::PPM:
+			return "ppm";
+		case ImageFormat::PNG:
+			return "png";
+		case ImageFormat::PFM:
+			return "pfm";
+		}
+		return "";
+	}
+
+	bool SaveImage(const Image& image, const std::string& filename, ImageFormat format)
+	{
+		switch (format)
+		{
+		case ImageFormat::BMP:
+			return SaveBMP(image, filename);
+		case ImageFormat::PPM:
+			return SavePPM(image, filename);
+		case ImageFormat::PNG:
+			return SavePNG(image, filename);
+		case ImageFormat::PFM:
+			return SavePFM(image, filename);
+		}
+		return false;
+	}
+
+	bool SaveBMP(const Image& image, const std::string& filename)
+	{
+		if (image.pixels.size() < size_t(image.width) * image.height * 3)
+			return false;
+
+		std::ofstream file(filename, std::ios::binary);
+		if (!file)
+			return false;
+
+		const uint32_t rowSize{ (uint32_t(image.width) * 3 + 3) & ~3u }; //rows are padded to 4 bytes
+		const uint32_t dataSize{ rowSize * uint32_t(image.height) };
+
+		//File header
+		file.write("BM", 2);
+		WriteU32LE(file, 54 + dataSize);
+		WriteU32LE(file, 0);
+		WriteU32LE(file, 54);
+
+		//Info header
+		WriteU32LE(file, 40);
+		WriteU32LE(file, uint32_t(image.width));
+		WriteU32LE(file, uint32_t(image.height)); //positive height >> bottom-up rows
+		WriteU16LE(file, 1);
+		WriteU16LE(file, 24);
+		WriteU32LE(file, 0);
+		WriteU32LE(file, dataSize);
+		WriteU32LE(file, 2835);
+		WriteU32LE(file, 2835);
+		WriteU32LE(file, 0);
+		WriteU32LE(file, 0);
+
+		std::vector<char> row(rowSize, 0);
+		for (int y{ image.height - 1 }; y >= 0; --y)
+		{
+			const uint8_t* pSource{ image.pixels.data() + size_t(y) * image.width * 3 };
+			for (int x{ 0 }; x < image.width; ++x)
+			{
+				row[x * 3 + 0] = char(pSource[x * 3 + 2]);
+				row[x * 3 + 1] = char(pSource[x * 3 + 1]);
+				row[x * 3 + 2] = char(pSource[x * 3 + 0]);
+			}
+			file.write(row.data(), rowSize);
+		}
+
+		return bool(file);
+	}
+
+	bool SavePPM(const Image& image, const std::string& filename)
+	{
+		if (image.pixels.size() < size_t(image.width) * image.height * 3)
+			return false;
+
+		std::ofstream file(filename, std::ios::binary);
+		if (!file)
+			return false;
+
+		file << "P6\n" << image.width << " " << image.height << "\n255\n";
+		file.write(reinterpret_cast<const char*>(image.pixels.data()), std::streamsize(size_t(image.width) * image.height * 3));
+
+		return bool(file);
+	}
+
+	bool SavePNG(const Image& image, const std::string& filename)
+	{
+		if (image.pixels.size() < size_t(image.width) * image.height * 3)
+			return false;
+
+		std::ofstream file(filename, std::ios::binary);
+		if (!file)
+			return false;
+
+		static const uint8_t signature[8]{ 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+		file.write(reinterpret_cast<const char*>(signature), 8);
+
+		std::vector<uint8_t> header{};
+		AppendU32BE(header, uint32_t(image.width));
+		AppendU32BE(header, uint32_t(image.height));
+		header.insert(header.end(), { 8, 2, 0, 0, 0 }); //8 bit, truecolor, deflate, no filter method, no interlace
+		WritePNGChunk(file, "IHDR", header);
+
+		//Raw scanlines, each prefixed with filter type 0 (none)
+		const size_t rowSize{ size_t(image.width) * 3 };
+		std::vector<uint8_t> scanlines{};
+		scanlines.reserve((rowSize + 1) * image.height);
+		for (int y{ 0 }; y < image.height; ++y)
+		{
+			scanlines.push_back(0);
+			const uint8_t* pRow{ image.pixels.data() + y * rowSize };
+			scanlines.insert(scanlines.end(), pRow, pRow + rowSize);
+		}
+
+		//zlib stream made of stored deflate blocks, no compression keeps the writer cheap
+		std::vector<uint8_t> idat{ 0x78, 0x01 };
+		const size_t maxBlockSize{ 65535 };
+		for (size_t offset{ 0 }; offset < scanlines.size() || offset == 0; offset += maxBlockSize)
+		{
+			const size_t blockSize{ std::min(maxBlockSize, scanlines.size() - offset) };
+			const bool isLast{ offset + blockSize >= scanlines.size() };
+			idat.push_back(isLast ? 1 : 0);
+			idat.push_back(uint8_t(blockSize & 0xFF));
+			idat.push_back(uint8_t(blockSize >> 8));
+			idat.push_back(uint8_t(~blockSize & 0xFF));
+			idat.push_back(uint8_t((~blockSize >> 8) & 0xFF));
+			idat.insert(idat.end(), scanlines.begin() + offset, scanlines.begin() + offset + blockSize);
+			if (isLast)
+				break;
+		}
+
+		uint32_t adlerA{ 1 };
+		uint32_t adlerB{ 0 };
+		for (const uint8_t byte : scanlines)
+		{
+			adlerA = (adlerA + byte) % 65521;
+			adlerB = (adlerB + adlerA) % 65521;
+		}
+		AppendU32BE(idat, (adlerB << 16) | adlerA);
+
+		WritePNGChunk(file, "IDAT", idat);
+		WritePNGChunk(file, "IEND", {});
+
+		return bool(file);
+	}
+
+	bool SavePFM(const Image& image, const std::string& filename)
+	{
+		if (image.radiance.size() < size_t(image.width) * image.height * 3)
+			return false;
+
+		std::ofstream file(filename, std::ios::binary);
+		if (!file)
+			return false;
+
+		//Negative scale >> little endian, rows are stored bottom to top
+		file << "PF\n" << image.width << " " << image.height << "\n-1.0\n";
+		const size_t rowSize{ size_t(image.width) * 3 };
+		for (int y{ image.height - 1 }; y >= 0; --y)
+			file.write(reinterpret_cast<const char*>(image.radiance.data() + y * rowSize), std::streamsize(rowSize * sizeof(float)));
+
+		return bool(file);
+	}
+
+	bool LoadPPM(const std::string& filename, Image& image)
+	{
+		std::ifstream file(filename, std::ios::binary);
+		if (!file)
+			return false;
+
+		std::string token{};
+		if (!ReadPNMHeaderToken(file, token) || token != "P6")
+			return false;
+
+		std::string width{}, height{}, maxValue{};
+		if (!ReadPNMHeaderToken(file, width) || !ReadPNMHeaderToken(file, height) || !ReadPNMHeaderToken(file, maxValue))
+			return false;
+		file.get(); //single whitespace before the data
+
+		int maxValueNumber{};
+		if (!ParseHeaderValue(width, image.width) || !ParseHeaderValue(height, image.height) || !ParseHeaderValue(maxValue, maxValueNumber))
+			return false;
+		if (maxValueNumber != 255 || image.width <= 0 || image.height <= 0)
+			return false;
+
+		image.pixels.resize(size_t(image.width) * image.height * 3);
+		image.radiance.clear();
+		file.read(reinterpret_cast<char*>(image.pixels.data()), std::streamsize(image.pixels.size()));
+
+		return bool(file);
+	}
+
+	bool LoadPFM(const std::string& filename, Image& image)
+	{
+		std::ifstream file(filename, std::ios::binary);
+		if (!file)
+			return false;
+
+		std::string type{}, width{}, height{}, scale{};
+		file >> type >> width >> height >> scale;
+		file.get();
+		if (!file || type != "PF")
+			return false;
+
+		float scaleNumber{};
+		if (!ParseHeaderValue(width, image.width) || !ParseHeaderValue(height, image.height) || !ParseHeaderValue(scale, scaleNumber))
+			return false;
+		if (scaleNumber > 0.f || image.width <= 0 || image.height <= 0) //only little endian data is supported
+			return false;
+
+		const size_t rowSize{ size_t(image.width) * 3 };
+		image.radiance.resize(rowSize * image.height);
+		image.pixels.clear();
+		for (int y{ image.height - 1 }; y >= 0; --y)
+			file.read(reinterpret_cast<char*>(image.radiance.data() + y * rowSize), std::streamsize(rowSize * sizeof(float)));
+
+		return bool(file);
+	}
+
+	bool LoadHDR(const std::string& filename, Image& image)
+	{
+		std::ifstream file(filename, std::ios::binary);
+		if (!file)
+			return false;
+
+		std::string line{};
+		std::getline(file, line);
+		if (line.rfind("#?", 0) != 0)
+			return false;
+
+		//Header lines up to an empty one, then the resolution
+		while (std::getline(file, line) && !line.empty())
+		{
+			if (line.rfind("FORMAT=", 0) == 0 && line != "FORMAT=32-bit_rle_rgbe")
+				return false;
+		}
+
+		std::string axisY{}, height{}, axisX{}, width{};
+		file >> axisY >> height >> axisX >> width;
+		file.get();
+		if (!file || axisY != "-Y" || axisX != "+X")
+			return false;
+
+		if (!ParseHeaderValue(width, image.width) || !ParseHeaderValue(height, image.height))
+			return false;
+		if (image.width <= 0 || image.height <= 0)
+			return false;
+
+		image.radiance.resize(size_t(image.width) * image.height * 3);
+		image.pixels.clear();
+
+		std::vector<uint8_t> scanline(size_t(image.width) * 4);
+		for (int y{ 0 }; y < image.height; ++y)
+		{
+			uint8_t start[4]{};
+			file.read(reinterpret_cast<char*>(start), 4);
+			if (!file)
+				return false;
+
+			const bool isRunLength{ image.width >= 8 && image.width < 32768 && start[0] == 2 && start[1] == 2
+				&& ((start[2] << 8) | start[3]) == image.width };
+			if (isRunLength)
+			{
+				//Every channel separately, counts above 128 repeat the next byte
+				for (int channel{ 0 }; channel < 4; ++channel)
+				{
+					int x{ 0 };
+					while (x < image.width)
+					{
+						int count{ file.get() };
+						if (count == EOF)
+							return false;
+
+						if (count > 128)
+						{
+							count -= 128;
+							const int value{ file.get() };
+							if (value == EOF || x + count > image.width)
+								return false;
+							for (int i{ 0 }; i < count; ++i)
+								scanline[size_t(x++) * 4 + channel] = uint8_t(value);
+						}
+						else
+						{
+							if (count == 0 || x + count > image.width)
+								return false;
+							for (int i{ 0 }; i < count; ++i)
+								scanline[size_t(x++) * 4 + channel] = uint8_t(file.get());
+						}
+					}
+				}
+			}
+			else
+			{
+				//Flat scanline, the 4 bytes already read are the first pixel
+				std::copy(start, start + 4, scanline.begin());
+				file.read(reinterpret_cast<char*>(scanline.data() + 4), std::streamsize(scanline.size() - 4));
+			}
+			if (!file)
+				return false;
+
+			float* pRow{ image.radiance.data() + size_t(y) * image.width * 3 };
+			for (int x{ 0 }; x < image.width; ++x)
+			{
+				const uint8_t* pRGBE{ scanline.data() + size_t(x) * 4 };
+				const float scale{ pRGBE[3] == 0 ? 0.f : ldexpf(1.f, int(pRGBE[3]) - (128 + 8)) };
+				for (int channel{ 0 }; channel < 3; ++channel)
+					pRow[x * 3 + channel] = pRGBE[3] == 0 ? 0.f : (float(pRGBE[channel]) + 0.5f) * scale;
+			}
+		}
+
+		return true;
+	}
+}
+}
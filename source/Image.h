@@ -0,0 +1,41 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace dae
+{
+	enum class ImageFormat
+	{
+		BMP, //8 bit, uncompressed
+		PPM, //8 bit, binary P6
+		PNG, //8 bit, stored (uncompressed) deflate blocks
+		PFM //32 bit float, linear radiance
+	};
+
+	//CPU side snapshot of a frame, rows from top to bottom
+	struct Image
+	{
+		int width{};
+		int height{};
+
+		std::vector<uint8_t> pixels{}; //display RGB, 3 bytes per pixel
+		std::vector<float> radiance{}; //linear RGB, 3 floats per pixel (optional, needed for PFM)
+	};
+
+	namespace ImageUtils
+	{
+		const char* GetExtension(ImageFormat format);
+
+		bool SaveImage(const Image& image, const std::string& filename, ImageFormat format);
+		bool SaveBMP(const Image& image, const std::string& filename);
+		bool SavePPM(const Image& image, const std::string& filename);
+		bool SavePNG(const Image& image, const std::string& filename);
+		bool SavePFM(const Image& image, const std::string& filename);
+
+		bool LoadPPM(const std::string& filename, Image& image);
+		bool LoadPFM(const std::string& filename, Image& image);
+		//Radiance RGBE (.hdr), flat or run length encoded scanlines in the standard -Y h +X w orientation
+		bool LoadHDR(const std::string& filename, Image& image);
+	}
+}
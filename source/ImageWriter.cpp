@@ -0,0 +1,218 @@
+#include "ImageWriter.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+using namespace dae;
+
+ImageWriter::ImageWriter(size_t maxQueuedImages) :
+	m_MaxQueuedImages(maxQueuedImages > 0 ? maxQueuedImages : 1),
+	m_Thread(&ImageWriter::Run, this)
+{
+}
+
+ImageWriter::~ImageWriter()
+{
+	{
+		std::lock_guard<std::mutex> lock{ m_Mutex };
+		m_IsStopping = true;
+	}
+	m_JobAdded.notify_all();
+	m_Thread.join();
+}
+
+bool ImageWriter::Submit(Image&& image, const std::string& filename, ImageFormat format, bool waitIfFull)
+{
+	Job job{};
+	job.type = JobType::Image;
+	job.image = std::move(image);
+	job.filename = filename;
+	job.format = format;
+	return Enqueue(std::move(job), waitIfFull);
+}
+
+void ImageWriter::OpenVideo(const std::string& filename, int width, int height, uint32_t framesPerSecond)
+{
+	Job job{};
+	job.type = JobType::OpenVideo;
+	job.image.width = width;
+	job.image.height = height;
+	job.filename = filename;
+	job.framesPerSecond = framesPerSecond;
+	Enqueue(std::move(job), true);
+}
+
+bool ImageWriter::SubmitVideoFrame(Image&& image, bool waitIfFull)
+{
+	Job job{};
+	job.type = JobType::VideoFrame;
+	job.image = std::move(image);
+	return Enqueue(std::move(job), waitIfFull);
+}
+
+void ImageWriter::CloseVideo()
+{
+	Job job{};
+	job.type = JobType::CloseVideo;
+	Enqueue(std::move(job), true);
+}
+
+bool ImageWriter::Enqueue(Job&& job, bool waitIfFull)
+{
+	{
+		std::unique_lock<std::mutex> lock{ m_Mutex };
+		if (m_Jobs.size() >= m_MaxQueuedImages)
+		{
+			if (!waitIfFull)
+			{
+				++m_NumDropped;
+				return false;
+			}
+			m_JobFinished.wait(lock, [this] { return m_Jobs.size() < m_MaxQueuedImages; });
+		}
+
+		m_Jobs.push_back(std::move(job));
+	}
+
+	m_JobAdded.notify_one();
+	return true;
+}
+
+void ImageWriter::Flush()
+{
+	std::unique_lock<std::mutex> lock{ m_Mutex };
+	m_JobFinished.wait(lock, [this] { return m_Jobs.empty() && !m_IsWriting; });
+}
+
+std::string ImageWriter::GetSequenceFilename(const std::string& baseName, uint32_t frameIndex, ImageFormat format)
+{
+	std::stringstream stream{};
+	stream << baseName << "_" << std::setw(4) << std::setfill('0') << frameIndex << "." << ImageUtils::GetExtension(format);
+	return stream.str();
+}
+
+void ImageWriter::Run()
+{
+	while (true)
+	{
+		Job job{};
+		{
+			std::unique_lock<std::mutex> lock{ m_Mutex };
+			m_JobAdded.wait(lock, [this] { return !m_Jobs.empty() || m_IsStopping; });
+
+			if (m_Jobs.empty()) //stopping and everything is written
+				return;
+
+			job = std::move(m_Jobs.front());
+			m_Jobs.pop_front();
+			m_IsWriting = true;
+		}
+
+		//Encoding + disk I/O without holding the lock
+		const bool isWritten{ Execute(job) };
+
+		{
+			std::lock_guard<std::mutex> lock{ m_Mutex };
+			m_IsWriting = false;
+			if (isWritten)
+				++m_NumWritten;
+			else
+				++m_NumFailed;
+		}
+		m_JobFinished.notify_all();
+	}
+}
+
+bool ImageWriter::Execute(Job& job)
+{
+	switch (job.type)
+	{
+	case JobType::Image:
+		if (!ImageUtils::SaveImage(job.image, job.filename, job.format))
+		{
+			std::cout << "Failed to write " << job.filename << std::endl;
+			return false;
+		}
+		return true;
+
+	case JobType::OpenVideo:
+		m_VideoFile = std::ofstream(job.filename, std::ios::binary);
+		if (!m_VideoFile)
+		{
+			std::cout << "Failed to open " << job.filename << std::endl;
+			return false;
+		}
+		m_VideoFile << "YUV4MPEG2 W" << job.image.width << " H" << job.image.height
+			<< " F" << job.framesPerSecond << ":1 Ip A1:1 C420jpeg\n";
+		return true;
+
+	case JobType::VideoFrame:
+		return WriteVideoFrame(job.image);
+
+	case JobType::CloseVideo:
+		m_VideoFile.close();
+		return true;
+	}
+	return false;
+}
+
+bool ImageWriter::WriteVideoFrame(const Image& image)
+{
+	if (!m_VideoFile.is_open() || image.pixels.size() < size_t(image.width) * image.height * 3)
+		return false;
+
+	const int width{ image.width };
+	const int height{ image.height };
+	const int chromaWidth{ (width + 1) / 2 };
+	const int chromaHeight{ (height + 1) / 2 };
+	const size_t lumaSize{ size_t(width) * height };
+	const size_t chromaSize{ size_t(chromaWidth) * chromaHeight };
+
+	m_VideoPlanes.resize(lumaSize + 2 * chromaSize);
+	uint8_t* pY{ m_VideoPlanes.data() };
+	uint8_t* pU{ pY + lumaSize };
+	uint8_t* pV{ pU + chromaSize };
+
+	//BT.601 limited range
+	for (size_t i{ 0 }; i < lumaSize; ++i)
+	{
+		const float r{ float(image.pixels[i * 3 + 0]) };
+		const float g{ float(image.pixels[i * 3 + 1]) };
+		const float b{ float(image.pixels[i * 3 + 2]) };
+		pY[i] = uint8_t(16.f + (65.481f * r + 128.553f * g + 24.966f * b) / 255.f + 0.5f);
+	}
+
+	//4:2:0, chroma from the average of each 2x2 block
+	for (int cy{ 0 }; cy < chromaHeight; ++cy)
+	{
+		for (int cx{ 0 }; cx < chromaWidth; ++cx)
+		{
+			float r{}, g{}, b{};
+			for (int dy{ 0 }; dy < 2; ++dy)
+			{
+				for (int dx{ 0 }; dx < 2; ++dx)
+				{
+					const int x{ std::min(cx * 2 + dx, width - 1) };
+					const int y{ std::min(cy * 2 + dy, height - 1) };
+					const uint8_t* pPixel{ image.pixels.data() + (size_t(y) * width + x) * 3 };
+					r += pPixel[0];
+					g += pPixel[1];
+					b += pPixel[2];
+				}
+			}
+			r *= 0.25f;
+			g *= 0.25f;
+			b *= 0.25f;
+
+			const size_t chromaIdx{ size_t(cy) * chromaWidth + cx };
+			pU[chromaIdx] = uint8_t(128.f + (-37.797f * r - 74.203f * g + 112.f * b) / 255.f + 0.5f);
+			pV[chromaIdx] = uint8_t(128.f + (112.f * r - 93.786f * g - 18.214f * b) / 255.f + 0.5f);
+		}
+	}
+
+	m_VideoFile << "FRAME\n";
+	m_VideoFile.write(reinterpret_cast<const char*>(m_VideoPlanes.data()), std::streamsize(m_VideoPlanes.size()));
+	return bool(m_VideoFile);
+}
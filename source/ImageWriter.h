@@ -0,0 +1,99 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "Image.h"
+
+namespace dae
+{
+	//Writes image snapshots to disk on a background I/O thread.
+	//The queue is bounded: when it is full a submit either drops the snapshot or waits for a free slot.
+	class ImageWriter final
+	{
+	public:
+		explicit ImageWriter(size_t maxQueuedImages = 8);
+		~ImageWriter(); //finishes all queued writes
+
+		ImageWriter(const ImageWriter&) = delete;
+		ImageWriter(ImageWriter&&) noexcept = delete;
+		ImageWriter& operator=(const ImageWriter&) = delete;
+		ImageWriter& operator=(ImageWriter&&) noexcept = delete;
+
+		/**
+		 * \brief Queues an image to be written
+		 * \param image snapshot, moved into the queue
+		 * \param filename output path
+		 * \param format file format
+		 * \param waitIfFull wait for a free slot instead of dropping the image when the queue is full
+		 * \return false if the image was dropped
+		 */
+		bool Submit(Image&& image, const std::string& filename, ImageFormat format, bool waitIfFull = false);
+
+		/**
+		 * \brief Starts an uncompressed YUV4MPEG2 (.y4m, 4:2:0) video, frames are appended with SubmitVideoFrame.
+		 * Like images, the RGB > YUV conversion and the writes happen on the I/O thread, so the caller can trace
+		 * the next frame while the previous one is being encoded.
+		 */
+		void OpenVideo(const std::string& filename, int width, int height, uint32_t framesPerSecond);
+		bool SubmitVideoFrame(Image&& image, bool waitIfFull = true);
+		void CloseVideo();
+
+		//Blocks until everything queued so far is on disk
+		void Flush();
+
+		//<baseName>_<frame, 4 digits>.<extension>
+		static std::string GetSequenceFilename(const std::string& baseName, uint32_t frameIndex, ImageFormat format);
+
+		uint32_t GetNumWritten() const { return m_NumWritten; }
+		uint32_t GetNumDropped() const { return m_NumDropped; }
+		uint32_t GetNumFailed() const { return m_NumFailed; }
+
+	private:
+		enum class JobType
+		{
+			Image,
+			OpenVideo,
+			VideoFrame,
+			CloseVideo
+		};
+
+		struct Job
+		{
+			JobType type{ JobType::Image };
+			Image image{};
+			std::string filename{};
+			ImageFormat format{};
+			uint32_t framesPerSecond{};
+		};
+
+		bool Enqueue(Job&& job, bool waitIfFull);
+		void Run();
+		bool Execute(Job& job);
+		bool WriteVideoFrame(const Image& image);
+
+		const size_t m_MaxQueuedImages;
+
+		std::mutex m_Mutex{};
+		std::condition_variable m_JobAdded{};
+		std::condition_variable m_JobFinished{};
+		std::deque<Job> m_Jobs{};
+		bool m_IsWriting{ false };
+		bool m_IsStopping{ false };
+
+		std::atomic<uint32_t> m_NumWritten{ 0 };
+		std::atomic<uint32_t> m_NumDropped{ 0 };
+		std::atomic<uint32_t> m_NumFailed{ 0 };
+
+		//Only touched by the I/O thread
+		std::ofstream m_VideoFile{};
+		std::vector<uint8_t> m_VideoPlanes{};
+
+		std::thread m_Thread; //started last, after all members above exist
+	};
+}
@@ -0,0 +1,116 @@
+#include "LightGrid.h"
+
+#include <algorithm>
+
+#include "DataTypes.h"
+
+using namespace dae;
+
+void LightGrid::Build(const std::vector<Light>& lights, uint32_t maxCellsPerAxis)
+{
+	m_CellOffsets.clear();
+	m_CellLights.clear();
+	m_GlobalLights.clear();
+
+	std::vector<uint32_t> boundedLights{};
+	for (uint32_t i{ 0 }; i < lights.size(); ++i)
+	{
+		if (lights[i].type == LightType::Point && lights[i].influenceRadius < FLT_MAX)
+			boundedLights.emplace_back(i);
+		else
+			m_GlobalLights.emplace_back(i);
+	}
+
+	if (boundedLights.empty())
+		return;
+
+	//Bounds of all influence spheres
+	Vector3 minBounds{ FLT_MAX, FLT_MAX, FLT_MAX };
+	Vector3 maxBounds{ -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	for (const uint32_t lightIndex : boundedLights)
+	{
+		const Light& light{ lights[lightIndex] };
+		const Vector3 radius{ light.influenceRadius, light.influenceRadius, light.influenceRadius };
+		minBounds = Vector3::Min(minBounds, light.origin - radius);
+		maxBounds = Vector3::Max(maxBounds, light.origin + radius);
+	}
+
+	//Roughly cubic cells, the longest axis gets maxCellsPerAxis.
+	//Lights with a zero influence radius (zero intensity) give a zero extent, the clamp keeps that one cell
+	const Vector3 extent{ maxBounds - minBounds };
+	const float cellSize{ std::max(std::max(std::max(extent.x, extent.y), extent.z) / float(std::max(maxCellsPerAxis, 1u)), FLT_EPSILON) };
+	for (int axis{ 0 }; axis < 3; ++axis)
+	{
+		m_NumCells[axis] = std::max(1, int(ceilf(extent[axis] / cellSize)));
+		m_InvCellSize[axis] = float(m_NumCells[axis]) / std::max(extent[axis], FLT_EPSILON);
+	}
+	m_MinBounds = minBounds;
+
+	const size_t numCells{ size_t(m_NumCells[0]) * m_NumCells[1] * m_NumCells[2] };
+	m_CellOffsets.assign(numCells + 1, 0);
+
+	//Two passes over the overlapping cells: count, then fill
+	const auto forEachOverlappingCell = [&](const Light& light, const auto& function)
+	{
+		int minCell[3]{};
+		int maxCell[3]{};
+		for (int axis{ 0 }; axis < 3; ++axis)
+		{
+			minCell[axis] = std::clamp(int((light.origin[axis] - light.influenceRadius - m_MinBounds[axis]) * m_InvCellSize[axis]), 0, m_NumCells[axis] - 1);
+			maxCell[axis] = std::clamp(int((light.origin[axis] + light.influenceRadius - m_MinBounds[axis]) * m_InvCellSize[axis]), 0, m_NumCells[axis] - 1);
+		}
+
+		const float sqrRadius{ light.influenceRadius * light.influenceRadius };
+		for (int z{ minCell[2] }; z <= maxCell[2]; ++z)
+		{
+			for (int y{ minCell[1] }; y <= maxCell[1]; ++y)
+			{
+				for (int x{ minCell[0] }; x <= maxCell[0]; ++x)
+				{
+					//Sphere - box overlap, distance from the light to the closest point of the cell
+					const int cell[3]{ x, y, z };
+					float sqrDistance{ 0.f };
+					for (int axis{ 0 }; axis < 3; ++axis)
+					{
+						const float cellMin{ m_MinBounds[axis] + float(cell[axis]) / m_InvCellSize[axis] };
+						const float cellMax{ m_MinBounds[axis] + float(cell[axis] + 1) / m_InvCellSize[axis] };
+						const float closest{ std::clamp(light.origin[axis], cellMin, cellMax) };
+						sqrDistance += Square(light.origin[axis] - closest);
+					}
+
+					if (sqrDistance <= sqrRadius)
+						function(GetCellIndex(x, y, z));
+				}
+			}
+		}
+	};
+
+	for (const uint32_t lightIndex : boundedLights)
+		forEachOverlappingCell(lights[lightIndex], [&](int cellIndex) { ++m_CellOffsets[cellIndex + 1]; });
+
+	for (size_t i{ 1 }; i <= numCells; ++i)
+		m_CellOffsets[i] += m_CellOffsets[i - 1];
+
+	m_CellLights.resize(m_CellOffsets[numCells]);
+	std::vector<uint32_t> writeOffsets{ m_CellOffsets.begin(), m_CellOffsets.end() - 1 };
+	for (const uint32_t lightIndex : boundedLights)
+		forEachOverlappingCell(lights[lightIndex], [&](int cellIndex) { m_CellLights[writeOffsets[cellIndex]++] = lightIndex; });
+}
+
+std::span<const uint32_t> LightGrid::GetLights(const Vector3& point) const
+{
+	if (m_CellOffsets.empty())
+		return {};
+
+	int cell[3]{};
+	for (int axis{ 0 }; axis < 3; ++axis)
+	{
+		const float position{ (point[axis] - m_MinBounds[axis]) * m_InvCellSize[axis] };
+		if (position < 0.f || position >= float(m_NumCells[axis]))
+			return {}; //outside every influence sphere
+		cell[axis] = int(position);
+	}
+
+	const int cellIndex{ GetCellIndex(cell[0], cell[1], cell[2]) };
+	return { m_CellLights.data() + m_CellOffsets[cellIndex], m_CellLights.data() + m_CellOffsets[cellIndex + 1] };
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "Math.h"
+
+namespace dae
+{
+	struct Light;
+
+	//Uniform 3D grid over the influence spheres of the point lights. Every cell lists the lights that can reach it,
+	//stored CSR style (one offset array + one flat index array) so a lookup is a single contiguous range.
+	class LightGrid final
+	{
+	public:
+		LightGrid() = default;
+		~LightGrid() = default;
+
+		LightGrid(const LightGrid&) = delete;
+		LightGrid(LightGrid&&) noexcept = delete;
+		LightGrid& operator=(const LightGrid&) = delete;
+		LightGrid& operator=(LightGrid&&) noexcept = delete;
+
+		/**
+		 * \brief Bins the lights by their influenceRadius
+		 * \param lights scene lights, directional and unbounded lights end up in the global list
+		 * \param maxCellsPerAxis resolution along the longest axis of the bounds
+		 */
+		void Build(const std::vector<Light>& lights, uint32_t maxCellsPerAxis = 16);
+
+		//Point lights whose influence sphere overlaps the cell containing point (empty outside the grid)
+		std::span<const uint32_t> GetLights(const Vector3& point) const;
+		//Lights that reach every point
+		const std::vector<uint32_t>& GetGlobalLights() const { return m_GlobalLights; }
+
+		bool IsEmpty() const { return m_CellOffsets.empty(); }
+
+	private:
+		Vector3 m_MinBounds{};
+		Vector3 m_InvCellSize{};
+		int m_NumCells[3]{};
+
+		std::vector<uint32_t> m_CellOffsets{}; //numCells + 1 entries
+		std::vector<uint32_t> m_CellLights{};
+		std::vector<uint32_t> m_GlobalLights{};
+
+		int GetCellIndex(int x, int y, int z) const { return (z * m_NumCells[1] + y) * m_NumCells[0] + x; }
+	};
+}
@@ -0,0 +1,151 @@
+#include "LightTree.h"
+
+#include <algorithm>
+
+#include "DataTypes.h"
+
+using namespace dae;
+
+void LightTree::Build(const std::vector<Light>& lights)
+{
+	m_Nodes.clear();
+	m_GlobalLights.clear();
+
+	std::vector<uint32_t> pointLights{};
+	for (uint32_t i{ 0 }; i < lights.size(); ++i)
+	{
+		if (lights[i].type == LightType::Point)
+			pointLights.emplace_back(i);
+		else
+			m_GlobalLights.emplace_back(i);
+	}
+
+	m_NumPointLights = uint32_t(pointLights.size());
+	if (pointLights.empty())
+		return;
+
+	m_Nodes.reserve(pointLights.size() * 2 - 1);
+	m_Nodes.emplace_back(); //root
+	BuildNode(lights, pointLights, 0, pointLights.size(), 0);
+}
+
+void LightTree::BuildNode(const std::vector<Light>& lights, std::vector<uint32_t>& lightIndices, size_t begin, size_t end, uint32_t nodeIndex)
+{
+	Node node{};
+	node.minAABB = lights[lightIndices[begin]].origin;
+	node.maxAABB = node.minAABB;
+	for (size_t i{ begin }; i < end; ++i)
+	{
+		const Light& light{ lights[lightIndices[i]] };
+		node.minAABB = Vector3::Min(node.minAABB, light.origin);
+		node.maxAABB = Vector3::Max(node.maxAABB, light.origin);
+		node.power += light.intensity * light.color.Luminance();
+	}
+
+	if (end - begin == 1)
+	{
+		node.lightIndex = lightIndices[begin];
+	}
+	else
+	{
+		//Median split along the longest axis
+		const Vector3 extent{ node.maxAABB - node.minAABB };
+		int axis{ 0 };
+		if (extent.y > extent.x)
+			axis = 1;
+		if (extent.z > extent[axis])
+			axis = 2;
+
+		const size_t middle{ begin + (end - begin) / 2 };
+		std::nth_element(lightIndices.begin() + begin, lightIndices.begin() + middle, lightIndices.begin() + end,
+			[&](uint32_t a, uint32_t b) { return lights[a].origin[axis] < lights[b].origin[axis]; });
+
+		//Children are stored next to each other, reserve both slots before recursing
+		node.childIndex = uint32_t(m_Nodes.size());
+		m_Nodes.emplace_back();
+		m_Nodes.emplace_back();
+
+		BuildNode(lights, lightIndices, begin, middle, node.childIndex);
+		BuildNode(lights, lightIndices, middle, end, node.childIndex + 1);
+	}
+
+	m_Nodes[nodeIndex] = node;
+}
+
+float LightTree::GetImportance(const Node& node, const Vector3& point, const Vector3& normal) const
+{
+	if (node.power <= 0.f)
+		return 0.f;
+
+	//Largest cosine towards any corner, if every corner is behind the surface so is every light inside
+	float maxCosine{ 0.f };
+	const bool isInside{ point.x >= node.minAABB.x && point.y >= node.minAABB.y && point.z >= node.minAABB.z
+		&& point.x <= node.maxAABB.x && point.y <= node.maxAABB.y && point.z <= node.maxAABB.z };
+	if (isInside)
+	{
+		maxCosine = 1.f;
+	}
+	else
+	{
+		for (int corner{ 0 }; corner < 8; ++corner)
+		{
+			const Vector3 cornerPoint{
+				(corner & 1) ? node.maxAABB.x : node.minAABB.x,
+				(corner & 2) ? node.maxAABB.y : node.minAABB.y,
+				(corner & 4) ? node.maxAABB.z : node.minAABB.z };
+			const Vector3 toCorner{ cornerPoint - point };
+			const float distance{ toCorner.Magnitude() };
+			if (distance > 0.f)
+				maxCosine = std::max(maxCosine, Vector3::Dot(normal, toCorner) / distance);
+		}
+	}
+
+	if (maxCosine <= 0.f)
+		return 0.f;
+
+	//Inverse square falloff to the center, clamped by the node size so close clusters don't blow up
+	const Vector3 center{ (node.minAABB + node.maxAABB) * 0.5f };
+	const float sqrDistance{ (center - point).SqrMagnitude() };
+	const float sqrHalfDiagonal{ ((node.maxAABB - node.minAABB) * 0.5f).SqrMagnitude() };
+
+	return node.power * maxCosine / std::max(sqrDistance, std::max(sqrHalfDiagonal, 1e-4f));
+}
+
+LightTree::LightSample LightTree::Sample(const Vector3& point, const Vector3& normal, float u) const
+{
+	LightSample sample{};
+	if (m_Nodes.empty())
+		return sample;
+
+	float pdf{ 1.f };
+	uint32_t nodeIndex{ 0 };
+	while (!m_Nodes[nodeIndex].IsLeaf())
+	{
+		const uint32_t leftIndex{ m_Nodes[nodeIndex].childIndex };
+		const float leftImportance{ GetImportance(m_Nodes[leftIndex], point, normal) };
+		const float rightImportance{ GetImportance(m_Nodes[leftIndex + 1], point, normal) };
+		const float totalImportance{ leftImportance + rightImportance };
+		if (totalImportance <= 0.f)
+			return sample;
+
+		//Pick a child and rescale u so it can be reused for the next level
+		const float leftProbability{ leftImportance / totalImportance };
+		if (u < leftProbability)
+		{
+			nodeIndex = leftIndex;
+			pdf *= leftProbability;
+			u = u / leftProbability;
+		}
+		else
+		{
+			nodeIndex = leftIndex + 1;
+			pdf *= 1.f - leftProbability;
+			u = (u - leftProbability) / (1.f - leftProbability);
+		}
+		u = std::min(u, 0.99999994f);
+	}
+
+	sample.lightIndex = m_Nodes[nodeIndex].lightIndex;
+	sample.pdf = pdf;
+	return sample;
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "Math.h"
+
+namespace dae
+{
+	struct Light;
+
+	//Binary tree over the point lights, each node stores the bounds and total power of the lights below it.
+	//Picking a light walks from the root, choosing a child with a probability proportional to its estimated
+	//contribution to the shading point, so the cost per hit is O(log n) instead of one shadow ray per light.
+	class LightTree final
+	{
+	public:
+		struct LightSample
+		{
+			uint32_t lightIndex{ UINT32_MAX }; //index in the scene lights
+			float pdf{ 0.f };
+		};
+
+		LightTree() = default;
+		~LightTree() = default;
+
+		LightTree(const LightTree&) = delete;
+		LightTree(LightTree&&) noexcept = delete;
+		LightTree& operator=(const LightTree&) = delete;
+		LightTree& operator=(LightTree&&) noexcept = delete;
+
+		//Point lights go into the tree, directional and area lights are listed separately (they are always shaded)
+		void Build(const std::vector<Light>& lights);
+
+		/**
+		 * \brief Picks one point light
+		 * \param point shading point
+		 * \param normal shading normal, lights completely behind the surface are never picked
+		 * \param u uniform random number in [0, 1)
+		 * \return picked light and the probability it was picked with, pdf 0 if nothing can contribute
+		 */
+		LightSample Sample(const Vector3& point, const Vector3& normal, float u) const;
+
+		uint32_t GetNumPointLights() const { return m_NumPointLights; }
+		const std::vector<uint32_t>& GetGlobalLights() const { return m_GlobalLights; }
+
+	private:
+		struct Node
+		{
+			Vector3 minAABB{};
+			Vector3 maxAABB{};
+			float power{ 0.f };
+
+			//Interior: children at childIndex and childIndex + 1, leaf: lightIndex
+			uint32_t childIndex{ 0 };
+			uint32_t lightIndex{ UINT32_MAX };
+
+			bool IsLeaf() const { return lightIndex != UINT32_MAX; }
+		};
+
+		std::vector<Node> m_Nodes{};
+		std::vector<uint32_t> m_GlobalLights{};
+		uint32_t m_NumPointLights{ 0 };
+
+		void BuildNode(const std::vector<Light>& lights, std::vector<uint32_t>& lightIndices, size_t begin, size_t end, uint32_t nodeIndex);
+		float GetImportance(const Node& node, const Vector3& point, const Vector3& normal) const;
+	};
+}
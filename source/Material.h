@@ -2,6 +2,8 @@
 #include "Math.h"
 #include "DataTypes.h"
 #include "BRDFs.h"
+#include "DFGTable.h"
+#include "Texture.h"
 
 namespace dae
 {
@@ -25,6 +27,32 @@ namespace dae
 		 * \return color
 		 */
 		virtual ColorRGB Shade(const HitRecord& hitRecord = {}, const Vector3& l = {}, const Vector3& v = {}) = 0;
+
+		/**
+		 * \brief Importance samples a light direction for the path tracer, cosine weighted unless overridden
+		 * \param hitRecord current hitrecord
+		 * \param v view direction (towards the previous path vertex)
+		 * \param u1, u2, u3 uniform random numbers in [0, 1), u3 picks a lobe
+		 * \param l sampled light direction (out)
+		 * \return solid angle pdf of l, 0 if no direction could be sampled
+		 */
+		virtual float Sample(const HitRecord& hitRecord, const Vector3& v, float u1, float u2, float u3, Vector3& l)
+		{
+			l = Sampling::CosineSampleHemisphere(hitRecord.normal, u1, u2);
+			return Pdf(hitRecord, l, v);
+		}
+
+		//Solid angle pdf with which Sample returns l, used for multiple importance sampling
+		virtual float Pdf(const HitRecord& hitRecord, const Vector3& l, const Vector3& v)
+		{
+			return std::max(0.f, Vector3::Dot(hitRecord.normal, l)) / PI;
+		}
+
+		//Surface color without lighting, guides the denoiser
+		virtual ColorRGB GetAlbedo(const HitRecord&)
+		{
+			return colors::White;
+		}
 	};
 #pragma endregion
 
@@ -43,6 +71,11 @@ namespace dae
 			return m_Color;
 		}
 
+		ColorRGB GetAlbedo(const HitRecord&) override
+		{
+			return m_Color;
+		}
+
 	private:
 		ColorRGB m_Color{colors::White};
 	};
@@ -62,12 +95,49 @@ namespace dae
 			return BRDF::Lambert(m_DiffuseReflectance, m_DiffuseColor);
 		}
 
+		ColorRGB GetAlbedo(const HitRecord&) override
+		{
+			return m_DiffuseReflectance * m_DiffuseColor;
+		}
+
 	private:
 		ColorRGB m_DiffuseColor{colors::White};
 		float m_DiffuseReflectance{1.f}; //kd
 	};
 #pragma endregion
 
+#pragma region Material TEXTURED LAMBERT
+	//TEXTURED LAMBERT
+	//================
+	class Material_TexturedLambert final : public Material
+	{
+	public:
+		//The texture is owned by the scene
+		Material_TexturedLambert(const Texture* pTexture, float diffuseReflectance) :
+			m_pTexture(pTexture), m_DiffuseReflectance(diffuseReflectance){}
+
+		ColorRGB Shade(const HitRecord& hitRecord = {}, const Vector3& l = {}, const Vector3& v = {}) override
+		{
+			return BRDF::Lambert(m_DiffuseReflectance, SampleTexture(hitRecord));
+		}
+
+		ColorRGB GetAlbedo(const HitRecord& hitRecord) override
+		{
+			return m_DiffuseReflectance * SampleTexture(hitRecord);
+		}
+
+	private:
+		const Texture* m_pTexture{};
+		float m_DiffuseReflectance{1.f}; //kd
+
+		//The mip level follows the pixel footprint, minified textures read small levels
+		ColorRGB SampleTexture(const HitRecord& hitRecord) const
+		{
+			return m_pTexture->Sample(hitRecord.u, hitRecord.v, m_pTexture->GetLod(hitRecord.footprint, hitRecord.uvDensity));
+		}
+	};
+#pragma endregion
+
 #pragma region Material LAMBERT PHONG
 	//LAMBERT-PHONG
 	//=============
@@ -86,6 +156,11 @@ namespace dae
 				BRDF::Phong(m_SpecularReflectance, m_PhongExponent, l, -v, hitRecord.normal);
 		}
 
+		ColorRGB GetAlbedo(const HitRecord&) override
+		{
+			return m_DiffuseColor;
+		}
+
 	private:
 		ColorRGB m_DiffuseColor{colors::White};
 		float m_DiffuseReflectance{0.5f}; //kd
@@ -96,15 +171,73 @@ namespace dae
 
 #pragma region Material COOK TORRENCE
 	//COOK TORRENCE
+	//Shades with constants precomputed at creation and the shared DFG table unless the analytic reference
+	//evaluation is selected (SetPrecomputedEvaluation), both give the same BRDF up to rounding
 	class Material_CookTorrence final : public Material
 	{
 	public:
 		Material_CookTorrence(const ColorRGB& albedo, float metalness, float roughness):
 			m_Albedo(albedo), m_Metalness(metalness), m_Roughness(roughness)
 		{
+			m_IsMetal = m_Metalness >= 0.001f || m_Metalness <= -0.001f;
+			m_F0 = m_IsMetal ? m_Albedo : ColorRGB{ 0.04f, 0.04f, 0.04f };
+			m_DiffuseColor = m_IsMetal ? ColorRGB{} : ColorRGB{ m_Albedo.r / PI, m_Albedo.g / PI, m_Albedo.b / PI };
+			m_Alpha = m_Roughness * m_Roughness;
+			m_AlphaSquared = m_Alpha * m_Alpha;
+			m_GGXNumerator = m_AlphaSquared / PI;
+			m_K = (m_Alpha + 1.f) * (m_Alpha + 1.f) / 8.f;
 		}
 
+		static void SetPrecomputedEvaluation(bool isEnabled) { s_IsPrecomputed = isEnabled; }
+		static bool IsPrecomputedEvaluation() { return s_IsPrecomputed; }
+
 		ColorRGB Shade(const HitRecord& hitRecord = {}, const Vector3& l = {}, const Vector3& v = {}) override
+		{
+			return s_IsPrecomputed ? ShadePrecomputed(hitRecord, l, v) : ShadeAnalytic(hitRecord, l, v);
+		}
+
+		//One normalization, no powf, the G / (4 * dot(n, v) * dot(n, l)) quotient folded into one visibility term
+		ColorRGB ShadePrecomputed(const HitRecord& hitRecord, const Vector3& l, const Vector3& v) const
+		{
+			const Vector3& normal{ hitRecord.normal };
+			const float dotNormalView{ Vector3::Dot(normal, v) };
+			const float dotNormalLight{ Vector3::Dot(normal, l) };
+
+			const Vector3 halfSum{ v + l };
+			const float halfSqrLength{ halfSum.SqrMagnitude() };
+			if (halfSqrLength <= 0.f)
+				return {};
+			const float invHalfLength{ FastMath::RSqrt(halfSqrLength) };
+			const float dotNormalHalf{ std::max(0.f, Vector3::Dot(normal, halfSum) * invHalfLength) };
+			const float dotViewHalf{ std::max(0.f, Vector3::Dot(v, halfSum) * invHalfLength) };
+
+			//Schlick weight (1 - cos)^5
+			const float fresnelWeight{ FastMath::PowInt<5>(1.f - dotViewHalf) };
+			const ColorRGB fresnel{
+				m_F0.r + (1.f - m_F0.r) * fresnelWeight,
+				m_F0.g + (1.f - m_F0.g) * fresnelWeight,
+				m_F0.b + (1.f - m_F0.b) * fresnelWeight };
+
+			float specular{ 0.f };
+			if (dotNormalView > 0.f && dotNormalLight > 0.f)
+			{
+				//1 - cos^2 as |n x h|^2, the usual form cancels catastrophically in the peak of smooth surfaces
+				const float sinNormalHalfSquared{ Vector3::Cross(normal, halfSum).SqrMagnitude() * invHalfLength * invHalfLength };
+				const float distribution{ dotNormalHalf * dotNormalHalf * m_AlphaSquared + sinNormalHalfSquared };
+				//D * G / (4 * dot(n, v) * dot(n, l)) in a single division
+				const float visibility{ 4.f * (dotNormalView * (1.f - m_K) + m_K) * (dotNormalLight * (1.f - m_K) + m_K) };
+				specular = m_GGXNumerator / (distribution * distribution * visibility);
+			}
+
+			//kd = 1 - F for dielectrics, metals have no diffuse color
+			return {
+				fresnel.r * specular + (1.f - fresnel.r) * m_DiffuseColor.r,
+				fresnel.g * specular + (1.f - fresnel.g) * m_DiffuseColor.g,
+				fresnel.b * specular + (1.f - fresnel.b) * m_DiffuseColor.b };
+		}
+
+		//Reference evaluation straight from the BRDF terms
+		ColorRGB ShadeAnalytic(const HitRecord& hitRecord, const Vector3& l, const Vector3& v) const
 		{
 			Vector3 halfVector = ((v + l) / (v + l).Magnitude()).Normalized();
 			ColorRGB f0{};
@@ -131,10 +264,79 @@ namespace dae
 
 		}
 
+		//Picks the GGX lobe or the diffuse lobe, proportional to their estimated reflectance
+		float Sample(const HitRecord& hitRecord, const Vector3& v, float u1, float u2, float u3, Vector3& l) override
+		{
+			if (u3 < GetSpecularProbability(hitRecord, v))
+			{
+				const Vector3 halfVector{ Sampling::GGXSampleHalfVector(hitRecord.normal, m_Alpha, u1, u2) };
+				l = Vector3::Reflect(-v, halfVector);
+			}
+			else
+				l = Sampling::CosineSampleHemisphere(hitRecord.normal, u1, u2);
+
+			return Pdf(hitRecord, l, v);
+		}
+
+		float Pdf(const HitRecord& hitRecord, const Vector3& l, const Vector3& v) override
+		{
+			const float dotNormalLight{ Vector3::Dot(hitRecord.normal, l) };
+			if (dotNormalLight <= 0.f)
+				return 0.f;
+
+			const Vector3 halfVector{ (v + l).Normalized() };
+			const float dotViewHalf{ std::abs(Vector3::Dot(v, halfVector)) };
+			const float dotNormalHalf{ std::max(0.f, Vector3::Dot(hitRecord.normal, halfVector)) };
+
+			//Half vector pdf D * cos(h) converted to the light direction
+			const float specularPdf{ dotViewHalf > 0.f ?
+				BRDF::NormalDistribution_GGX(hitRecord.normal, halfVector, m_Alpha) * dotNormalHalf / (4.f * dotViewHalf) : 0.f };
+			const float diffusePdf{ dotNormalLight / PI };
+
+			const float specularProbability{ GetSpecularProbability(hitRecord, v) };
+			return specularProbability * specularPdf + (1.f - specularProbability) * diffusePdf;
+		}
+
+		ColorRGB GetAlbedo(const HitRecord&) override
+		{
+			return m_Albedo;
+		}
+
 	private:
+		inline static bool s_IsPrecomputed{ true };
+
+		float GetSpecularProbability(const HitRecord& hitRecord, const Vector3& v) const
+		{
+			if (m_IsMetal)
+				return 1.f; //metals have no diffuse lobe
+
+			float specular{};
+			if (s_IsPrecomputed)
+			{
+				//Directional albedo of the GGX lobe at this view angle and roughness
+				float scale{}, bias{};
+				DFGTable::Get().Lookup(Vector3::Dot(hitRecord.normal, v), m_Roughness, scale, bias);
+				specular = m_F0.Luminance() * scale + bias;
+			}
+			else
+				specular = BRDF::FresnelFunction_Schlick(hitRecord.normal, v, m_F0).Luminance();
+
+			const float diffuse{ (1.f - specular) * m_Albedo.Luminance() };
+			return std::clamp(specular / std::max(specular + diffuse, FLT_EPSILON), 0.1f, 0.9f);
+		}
+
 		ColorRGB m_Albedo{0.955f, 0.637f, 0.538f}; //Copper
 		float m_Metalness{1.0f};
 		float m_Roughness{0.1f}; // [1.0 > 0.0] >> [ROUGH > SMOOTH]
+
+		//Precomputed at creation
+		bool m_IsMetal{ true };
+		ColorRGB m_F0{};
+		ColorRGB m_DiffuseColor{}; //albedo / pi, black for metals
+		float m_Alpha{};
+		float m_AlphaSquared{};
+		float m_GGXNumerator{}; //alpha^2 / pi
+		float m_K{}; //Schlick-GGX k, (alpha + 1)^2 / 8
 	};
 #pragma endregion
 }
@@ -2,6 +2,9 @@
 #include "Vector3.h"
 #include "Vector4.h"
 #include "Matrix.h"
+#include "Transform.h"
 #include "ColorRGB.h"
 #include "MathHelpers.h"
+#include "FastMath.h"
+#include "Sampling.h"
 
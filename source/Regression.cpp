@@ -0,0 +1,240 @@
+#include "Regression.h"
+
+#include <cmath>
+#include <filesystem>
+#include <iostream>
+
+#include "Image.h"
+#include "Renderer.h"
+#include "Scene.h"
+#include "Timer.h"
+#include "ToneMapping.h"
+
+namespace dae {
+namespace Regression {
+
+#pragma region Helpers
+	//Display-referred CIELAB (D65) of a linear radiance value, tonemapped like the default resolve pass
+	static void RadianceToLab(const float* pRadiance, float* pLab)
+	{
+		const float r{ ToneMapping::ACES(pRadiance[0]) };
+		const float g{ ToneMapping::ACES(pRadiance[1]) };
+		const float b{ ToneMapping::ACES(pRadiance[2]) };
+
+		//Linear sRGB >> XYZ, normalized by the white point
+		const float x{ (0.4124f * r + 0.3576f * g + 0.1805f * b) / 0.9505f };
+		const float y{ 0.2126f * r + 0.7152f * g + 0.0722f * b };
+		const float z{ (0.0193f * r + 0.1192f * g + 0.9505f * b) / 1.089f };
+
+		const auto f = [](float t)
+		{
+			return t > 0.008856f ? cbrtf(t) : 7.787f * t + 16.f / 116.f;
+		};
+		const float fx{ f(x) };
+		const float fy{ f(y) };
+		const float fz{ f(z) };
+
+		pLab[0] = 116.f * fy - 16.f;
+		pLab[1] = 500.f * (fx - fy);
+		pLab[2] = 200.f * (fy - fz);
+	}
+
+	//3x3 box filter, like the spatial filter of FLIP it hides single pixel noise that is not visible at viewing distance
+	static std::vector<float> FilterLab(const std::vector<float>& lab, int width, int height)
+	{
+		std::vector<float> filtered(lab.size());
+		for (int py{ 0 }; py < height; ++py)
+		{
+			for (int px{ 0 }; px < width; ++px)
+			{
+				float sum[3]{};
+				int count{ 0 };
+				for (int dy{ -1 }; dy <= 1; ++dy)
+				{
+					for (int dx{ -1 }; dx <= 1; ++dx)
+					{
+						const int x{ px + dx };
+						const int y{ py + dy };
+						if (x < 0 || y < 0 || x >= width || y >= height)
+							continue;
+
+						const float* pLab{ lab.data() + (size_t(y) * width + x) * 3 };
+						sum[0] += pLab[0];
+						sum[1] += pLab[1];
+						sum[2] += pLab[2];
+						++count;
+					}
+				}
+
+				float* pFiltered{ filtered.data() + (size_t(py) * width + px) * 3 };
+				for (int c{ 0 }; c < 3; ++c)
+					pFiltered[c] = sum[c] / float(count);
+			}
+		}
+		return filtered;
+	}
+
+	static std::vector<float> ToFilteredLab(const Image& image)
+	{
+		const size_t numPixels{ size_t(image.width) * image.height };
+		std::vector<float> lab(numPixels * 3);
+		for (size_t i{ 0 }; i < numPixels; ++i)
+			RadianceToLab(image.radiance.data() + i * 3, lab.data() + i * 3);
+
+		return FilterLab(lab, image.width, image.height);
+	}
+
+	static Image RenderScene(const RegressionScene& regressionScene, Renderer& renderer, uint32_t samplesPerPixel)
+	{
+		Scene* pScene{ regressionScene.create() };
+		pScene->Initialize();
+
+		//No live input and simulation time 0, every run traces the same rays
+		pScene->GetCamera().processInput = [](const CameraInput&) { return CameraInput{}; };
+		Timer timer{};
+		timer.SetFixedTimeStep(1.f / 30.f);
+		pScene->Update(&timer);
+
+		renderer.SetMaxSamples(samplesPerPixel);
+		renderer.InvalidateFrame();
+		while (renderer.Render(pScene)) {}
+
+		Image image{ renderer.CaptureImage() };
+		delete pScene;
+		return image;
+	}
+#pragma endregion
+
+	const std::vector<RegressionScene>& GetRegressionScenes()
+	{
+		static const std::vector<RegressionScene> scenes
+		{
+			{ "W4_BunnyScene", []() -> Scene* { return new Scene_W4_BunnyScene(); } },
+			{ "W4_ReferenceScene", []() -> Scene* { return new Scene_W4_ReferenceScene(); } },
+			{ "ManyLights", []() -> Scene* { return new Scene_ManyLights(); } },
+			{ "AreaLights", []() -> Scene* { return new Scene_AreaLights(); } },
+			{ "Textures", []() -> Scene* { return new Scene_Textures(); } },
+			{ "Environment", []() -> Scene* { return new Scene_Environment(); } }
+		};
+		return scenes;
+	}
+
+	ImageDifference Compare(const Image& image, const Image& reference, float perceptualThreshold)
+	{
+		ImageDifference difference{};
+		const size_t numPixels{ size_t(image.width) * image.height };
+
+		//RMSE of the linear values, relative so bright and dark scenes share a tolerance
+		double squaredError{ 0.0 };
+		double referenceSum{ 0.0 };
+		for (size_t i{ 0 }; i < numPixels * 3; ++i)
+		{
+			const double error{ double(image.radiance[i]) - double(reference.radiance[i]) };
+			squaredError += error * error;
+			referenceSum += reference.radiance[i];
+		}
+		const double referenceMean{ std::max(referenceSum / double(numPixels * 3), 1e-4) };
+		difference.rmse = float(sqrt(squaredError / double(numPixels * 3)) / referenceMean);
+
+		//Perceptual: delta E of the filtered display colors
+		const std::vector<float> lab{ ToFilteredLab(image) };
+		const std::vector<float> referenceLab{ ToFilteredLab(reference) };
+
+		difference.deltaE.resize(numPixels);
+		double deltaESum{ 0.0 };
+		size_t numVisible{ 0 };
+		for (size_t i{ 0 }; i < numPixels; ++i)
+		{
+			const float dL{ lab[i * 3 + 0] - referenceLab[i * 3 + 0] };
+			const float da{ lab[i * 3 + 1] - referenceLab[i * 3 + 1] };
+			const float db{ lab[i * 3 + 2] - referenceLab[i * 3 + 2] };
+			const float deltaE{ sqrtf(dL * dL + da * da + db * db) };
+
+			difference.deltaE[i] = deltaE;
+			deltaESum += deltaE;
+			if (deltaE > perceptualThreshold)
+				++numVisible;
+		}
+		difference.meanDeltaE = float(deltaESum / double(numPixels));
+		difference.perceptualFraction = float(double(numVisible) / double(numPixels));
+
+		return difference;
+	}
+
+	Image CreateDiffImage(const ImageDifference& difference, int width, int height, float perceptualThreshold)
+	{
+		Image image{};
+		image.width = width;
+		image.height = height;
+		image.pixels.resize(size_t(width) * height * 3);
+
+		for (size_t i{ 0 }; i < difference.deltaE.size(); ++i)
+		{
+			const float t{ std::min(difference.deltaE[i] / (4.f * perceptualThreshold), 1.f) };
+			image.pixels[i * 3 + 0] = uint8_t(std::min(t * 2.f, 1.f) * 255.f);
+			image.pixels[i * 3 + 1] = uint8_t(std::max(t * 2.f - 1.f, 0.f) * 255.f);
+			image.pixels[i * 3 + 2] = 0;
+		}
+		return image;
+	}
+
+	int Run(SDL_Window* pWindow, const RegressionSettings& settings)
+	{
+		std::filesystem::create_directories(settings.directory);
+
+		//Fixed settings, adaptive sampling would make the result depend on its threshold
+		Renderer renderer{ pWindow };
+		renderer.SetProgressive(true);
+		renderer.SetAdaptiveSampling(false);
+
+		int numFailed{ 0 };
+		for (const RegressionScene& regressionScene : GetRegressionScenes())
+		{
+			const std::string basePath{ settings.directory + "/" + regressionScene.name };
+			const std::string referencePath{ basePath + ".pfm" };
+
+			const Image image{ RenderScene(regressionScene, renderer, settings.samplesPerPixel) };
+
+			Image reference{};
+			if (settings.updateReferences || !ImageUtils::LoadPFM(referencePath, reference))
+			{
+				if (ImageUtils::SavePFM(image, referencePath))
+					std::cout << "[REFERENCE] " << regressionScene.name << " >> " << referencePath << std::endl;
+				else
+				{
+					std::cout << "[FAILED] " << regressionScene.name << ": could not write " << referencePath << std::endl;
+					++numFailed;
+				}
+				continue;
+			}
+
+			if (reference.width != image.width || reference.height != image.height)
+			{
+				std::cout << "[FAILED] " << regressionScene.name << ": reference is " << reference.width << "x" << reference.height
+					<< ", render is " << image.width << "x" << image.height << std::endl;
+				++numFailed;
+				continue;
+			}
+
+			const ImageDifference difference{ Compare(image, reference, settings.perceptualThreshold) };
+			const bool isPassed{ difference.rmse <= settings.maxRMSE && difference.perceptualFraction <= settings.maxPerceptualFraction };
+
+			std::cout << (isPassed ? "[PASSED] " : "[FAILED] ") << regressionScene.name
+				<< ": RMSE = " << difference.rmse
+				<< ", mean dE = " << difference.meanDeltaE
+				<< ", visible = " << difference.perceptualFraction * 100.f << "%" << std::endl;
+
+			if (!isPassed)
+			{
+				++numFailed;
+				ImageUtils::SavePFM(image, basePath + "_actual.pfm");
+				ImageUtils::SavePNG(image, basePath + "_actual.png");
+				ImageUtils::SavePNG(CreateDiffImage(difference, image.width, image.height, settings.perceptualThreshold), basePath + "_diff.png");
+			}
+		}
+
+		std::cout << "Regression: " << GetRegressionScenes().size() - numFailed << "/" << GetRegressionScenes().size() << " passed" << std::endl;
+		return numFailed;
+	}
+}
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+struct SDL_Window;
+
+namespace dae
+{
+	class Scene;
+	struct Image;
+
+	//Scenes covered by the regression run, new scenes register themselves in GetRegressionScenes
+	struct RegressionScene
+	{
+		std::string name{};
+		std::function<Scene*()> create{};
+	};
+
+	struct RegressionSettings
+	{
+		std::string directory{ "Regression" }; //references (<scene>.pfm), failed outputs and diff images
+		uint32_t samplesPerPixel{ 64 };
+		bool updateReferences{ false }; //overwrite the references instead of comparing
+
+		float maxRMSE{ 0.01f }; //root mean square error of the linear radiance, relative to the mean reference value
+		float perceptualThreshold{ 2.f }; //CIELAB delta E at which a pixel counts as visibly different
+		float maxPerceptualFraction{ 0.001f }; //fraction of visibly different pixels that is still accepted
+	};
+
+	//Result of comparing a render against its reference
+	struct ImageDifference
+	{
+		float rmse{ 0.f };
+		float meanDeltaE{ 0.f };
+		float perceptualFraction{ 0.f };
+		std::vector<float> deltaE{}; //per pixel
+	};
+
+	namespace Regression
+	{
+		const std::vector<RegressionScene>& GetRegressionScenes();
+
+		/**
+		 * \brief Renders every registered scene at fixed settings (fixed clock, no camera input, no adaptive sampling)
+		 * and compares it against the stored reference. Missing references are created.
+		 * \return number of failed scenes
+		 */
+		int Run(SDL_Window* pWindow, const RegressionSettings& settings);
+
+		//Both images need linear radiance of the same size
+		ImageDifference Compare(const Image& image, const Image& reference, float perceptualThreshold);
+		//Heat map of the per pixel delta E, black (equal) > red > yellow (>= 4 * threshold)
+		Image CreateDiffImage(const ImageDifference& difference, int width, int height, float perceptualThreshold);
+	}
+}
@@ -7,10 +7,13 @@
 #include "Math.h"
 #include "Matrix.h"
 #include "Material.h"
+#include "EnvironmentMap.h"
 #include "Scene.h"
 #include "Utils.h"
 
+#include <chrono>
 #include <future> //async
+#include <iostream>
 #include <ppl.h> //parallel for
 
 using namespace dae;
@@ -24,21 +27,94 @@ Renderer::Renderer(SDL_Window * pWindow) :
 {
 	//Initialize
 	SDL_GetWindowSize(pWindow, &m_Width, &m_Height);
+	m_RenderWidth = m_Width;
+	m_RenderHeight = m_Height;
 	m_pBufferPixels = static_cast<uint32_t*>(m_pBuffer->pixels);
+	const size_t numPixels{ size_t(m_Width) * m_Height };
+	m_AccumulationBuffer.resize(numPixels);
+	m_SampleCountBuffer.resize(numPixels);
+	m_LuminanceSqBuffer.resize(numPixels);
+	m_ResolveBuffer.resize(numPixels * 3);
+	m_AlbedoBuffer.resize(numPixels);
+	m_NormalBuffer.resize(numPixels);
+	m_DepthBuffer.resize(numPixels, FLT_MAX);
+	m_DenoisedBuffer.resize(numPixels);
+	m_HistoryAccumulationBuffer.resize(numPixels);
+	m_HistorySampleCountBuffer.resize(numPixels);
+	m_HistoryLuminanceSqBuffer.resize(numPixels);
+	m_HistoryDepthBuffer.resize(numPixels, FLT_MAX);
+	m_HistoryNormalBuffer.resize(numPixels);
+	m_FreshSampleCountBuffer.resize(numPixels);
 }
 
-void Renderer::Render(Scene* pScene) const
+bool Renderer::Render(Scene* pScene)
 {
 	Camera& camera{ pScene->GetCamera() };
+	const auto frameStart{ std::chrono::steady_clock::now() };
+
+	//A still view that was traced at a reduced resolution restarts at full resolution, reprojecting the low resolution frame
+	const bool hasFrameChanged{ HasFrameChanged(pScene) };
+	const bool isRenderScaled{ m_RenderWidth != m_Width || m_RenderHeight != m_Height };
+	const bool isRestoringResolution{ !hasFrameChanged && m_ProgressiveEnabled && isRenderScaled };
+
+	if (hasFrameChanged || isRestoringResolution)
+	{
+		//Only the camera moved >> the current frame becomes the history the new view reprojects
+		const bool isSameContent{ m_IsFrameValid && m_AccumulationPass > 0
+			&& pScene == m_pLastScene && pScene->GetVersion() == m_LastSceneVersion };
+
+		//The last frame also tells where the new one can afford fewer rays
+		const bool hasShadingRates{ hasFrameChanged && isSameContent && m_VariableRateEnabled };
+		if (hasShadingRates)
+			BuildShadingRates();
+
+		m_IsReprojecting = m_TemporalEnabled && isSameContent;
+		if (m_IsReprojecting)
+		{
+			m_HistoryAccumulationBuffer.swap(m_AccumulationBuffer);
+			m_HistorySampleCountBuffer.swap(m_SampleCountBuffer);
+			m_HistoryLuminanceSqBuffer.swap(m_LuminanceSqBuffer);
+			m_HistoryDepthBuffer.swap(m_DepthBuffer);
+			m_HistoryNormalBuffer.swap(m_NormalBuffer);
+			m_NumReprojectedPixels = 0;
+		}
+
+		//Only moving views are traced below full resolution
+		SetRenderScale(hasFrameChanged && m_DynamicResolutionEnabled ? m_TargetRenderScale : 1.f);
+		m_IsVariableRatePass = hasShadingRates && m_ShadingRateWidth == m_RenderWidth && m_ShadingRateHeight == m_RenderHeight;
+
+		//Restart accumulation, the first sample of the new view overwrites the buffer
+		m_IsFrameValid = true;
+		m_pLastScene = pScene;
+		m_LastSceneVersion = pScene->GetVersion();
+		m_LastCameraVersion = camera.version;
+		m_AccumulationPass = 0;
+	}
+	else if (!m_ProgressiveEnabled || m_NumActivePixels == 0)
+	{
+		//Same camera, scene and settings and nothing left to refine >> the buffer is still valid
+		SDL_UpdateWindowSurface(m_pWindow);
+		return false;
+	}
+
 	camera.CalculateCameraToWorld();
 
 	const float fov{ camera.fov };
 	const float aspectRatio{ float(m_Width) / float(m_Height) };
+	m_CameraRays.Update(m_RenderWidth, m_RenderHeight, fov, aspectRatio, camera.right, camera.up, camera.forward);
 
 	const auto& materials{ pScene->GetMaterials() };
 	const auto& lights{ pScene->GetLights() };
 
-	const uint32_t numPixels{ uint32_t(m_Width * m_Height) };
+	const uint32_t numPixels{ uint32_t(m_RenderWidth * m_RenderHeight) };
+	m_NumActivePixels = 0;
+	m_NumShadowRaysTraced = 0;
+	m_NumShadowRaysSkipped = 0;
+	m_NumPaths = 0;
+	m_NumPathBounces = 0;
+	m_NumRouletteTerminations = 0;
+	for (std::atomic<uint32_t>& count : m_PathLengthHistogram)
+		count = 0;
 
 #if defined(ASYNC)
 	//async exeution
@@ -62,7 +138,7 @@ void Renderer::Render(Scene* pScene) const
 			{
 				uint32_t pixelEnd = currPixelIdx + taskSize;
 				for (uint32_t i = currPixelIdx; i < pixelEnd; ++i)
-					RenderPixel(pScene, i, fov, aspectRatio, camera, lights, materials);		
+					RenderPixel(pScene, i, camera, lights, materials);		
 			}));
 
 		currPixelIdx += taskSize;
@@ -76,28 +152,129 @@ void Renderer::Render(Scene* pScene) const
 	//parallel
 	concurrency::parallel_for(0u, numPixels, [=, this](int pixelIndex)
 		{
-			RenderPixel(pScene, pixelIndex, fov, aspectRatio, camera, lights, materials);
+			RenderPixel(pScene, pixelIndex, camera, lights, materials);
 		});
 
 #else
 	//synchronous
 	for (uint32_t pixel{0}; pixel < numPixels; ++pixel)
-		RenderPixel(pScene, pixel, fov, aspectRatio, camera, lights, materials);
+		RenderPixel(pScene, pixel, camera, lights, materials);
 	
 #endif
 
+	if (m_IsVariableRatePass)
+		InterpolateSkippedPixels();
+
+	++m_AccumulationPass;
+	m_IsReprojecting = false;
+	m_IsVariableRatePass = false;
+
+	//The view the next camera move reprojects from
+	m_PreviousView.origin = camera.origin;
+	m_PreviousView.right = camera.right;
+	m_PreviousView.up = camera.up;
+	m_PreviousView.forward = camera.forward;
+	m_PreviousView.fov = fov;
+	m_PreviousView.aspectRatio = aspectRatio;
+	m_PreviousView.width = m_RenderWidth;
+	m_PreviousView.height = m_RenderHeight;
+
 	//@END
 	//Update SDL Surface
-	SDL_UpdateWindowSurface(m_pWindow);
+	m_HasNewSamples = true;
+	PresentBuffer();
+
+	//Only full passes of a moving view drive the resolution, refinement passes trace fewer pixels
+	m_LastFrameTime = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
+	if (hasFrameChanged && m_DynamicResolutionEnabled)
+		UpdateRenderScale(m_LastFrameTime);
+	return true;
+}
+
+void Renderer::SetRenderScale(float scale)
+{
+	m_RenderScale = scale;
+	m_RenderWidth = std::clamp(int(float(m_Width) * scale + 0.5f), 1, m_Width);
+	m_RenderHeight = std::clamp(int(float(m_Height) * scale + 0.5f), 1, m_Height);
+}
+
+void Renderer::UpdateRenderScale(float frameTime)
+{
+	//Frame time grows with the number of traced pixels (scale squared), solve for the scale that fits the budget
+	const float idealScale{ m_RenderScale * sqrtf(m_FrameTimeBudget / std::max(frameTime, 0.01f)) };
+
+	//Damped, a single slow or fast frame only moves halfway
+	m_TargetRenderScale = std::clamp(m_RenderScale + (idealScale - m_RenderScale) * 0.5f, m_MinRenderScale, 1.f);
+}
+
+void Renderer::ToggleDynamicResolution()
+{
+	m_DynamicResolutionEnabled = !m_DynamicResolutionEnabled;
+	m_TargetRenderScale = 1.f;
+	std::cout << "Dynamic resolution: " << (m_DynamicResolutionEnabled ? "on" : "off")
+		<< " (budget " << m_FrameTimeBudget << " ms)" << std::endl;
+}
+
+void Renderer::SetFrameTimeBudget(float milliseconds)
+{
+	m_FrameTimeBudget = std::max(milliseconds, 1.f);
+	m_DynamicResolutionEnabled = true;
+	m_TargetRenderScale = 1.f;
 }
 
-bool Renderer::SaveBufferToImage() const
+bool Renderer::HasFrameChanged(Scene* pScene) const
 {
-	return SDL_SaveBMP(m_pBuffer, "RayTracing_Buffer.bmp");
+	return !m_IsFrameValid
+		|| pScene != m_pLastScene
+		|| pScene->GetVersion() != m_LastSceneVersion
+		|| pScene->GetCamera().version != m_LastCameraVersion;
+}
+
+Image Renderer::CaptureImage() const
+{
+	Image image{};
+	image.width = m_Width;
+	image.height = m_Height;
+
+	const size_t numPixels{ size_t(m_Width) * m_Height };
+	image.pixels.resize(numPixels * 3);
+	image.radiance.resize(numPixels * 3);
+
+	const SDL_PixelFormat* pFormat{ m_pBuffer->format };
+	for (size_t pixelIdx{ 0 }; pixelIdx < numPixels; ++pixelIdx)
+	{
+		const int px{ int(pixelIdx % m_Width) };
+		const int py{ int(pixelIdx / m_Width) };
+
+		const uint32_t pixel{ m_pBufferPixels[pixelIdx] };
+		image.pixels[pixelIdx * 3 + 0] = uint8_t(((pixel & pFormat->Rmask) >> pFormat->Rshift) << pFormat->Rloss);
+		image.pixels[pixelIdx * 3 + 1] = uint8_t(((pixel & pFormat->Gmask) >> pFormat->Gshift) << pFormat->Gloss);
+		image.pixels[pixelIdx * 3 + 2] = uint8_t(((pixel & pFormat->Bmask) >> pFormat->Bshift) << pFormat->Bloss);
+
+		const ColorRGB radiance{ GetDisplayRadiance(px, py) };
+		image.radiance[pixelIdx * 3 + 0] = radiance.r * m_Exposure;
+		image.radiance[pixelIdx * 3 + 1] = radiance.g * m_Exposure;
+		image.radiance[pixelIdx * 3 + 2] = radiance.b * m_Exposure;
+	}
+
+	return image;
+}
+
+bool Renderer::SaveBufferToImage(ImageFormat format)
+{
+	const std::string filename{ std::string("RayTracing_Buffer.") + ImageUtils::GetExtension(format) };
+	return m_ImageWriter.Submit(CaptureImage(), filename, format);
+}
+
+bool Renderer::SaveFrameToSequence(const std::string& baseName, uint32_t frameIndex, ImageFormat format, bool waitIfFull)
+{
+	return m_ImageWriter.Submit(CaptureImage(), ImageWriter::GetSequenceFilename(baseName, frameIndex, format), format, waitIfFull);
 }
 
 void Renderer::CycleLightMode()
 {
+	m_IsFrameValid = false;
+
 	switch (m_CurrentLightingMode)
 	{
 	case LightingMode::Combined:
@@ -115,63 +292,905 @@ void Renderer::CycleLightMode()
 	}
 }
 
-void Renderer::RenderPixel(Scene* pScene, uint32_t pixelIdx, float fov, float aspectRatio, const Camera& camera, 
-							const std::vector<Light>& lights, const std::vector<Material*>& materials) const
+void Renderer::CycleDisplayMode()
 {
-	const int px{ int(pixelIdx) % m_Width };
-	const int py{ int(pixelIdx) / m_Width };
+	switch (m_CurrentDisplayMode)
+	{
+	case DisplayMode::Color:
+		m_CurrentDisplayMode = DisplayMode::SamplesPerPixel;
+		break;
+	case DisplayMode::SamplesPerPixel:
+		m_CurrentDisplayMode = DisplayMode::Color;
+		break;
+	}
 
-	const float x{ float(((2 * (px + 0.5)) / m_Width) - 1) * aspectRatio * fov };
-	const float y{ (1 - float((2 * (py + 0.5)) / m_Height)) * fov };
-	
-	const Vector3 rayDirection{ camera.cameraToWorld.TransformVector({ x, y, 1 }).Normalized() };
+	//Only the displayed values change, resolve again without tracing
+	PresentBuffer();
+}
+
+void Renderer::CycleToneMapper()
+{
+	switch (m_CurrentToneMapper)
+	{
+	case ToneMapper::MaxToOne:
+		m_CurrentToneMapper = ToneMapper::Reinhard;
+		break;
+	case ToneMapper::Reinhard:
+		m_CurrentToneMapper = ToneMapper::ACES;
+		break;
+	case ToneMapper::ACES:
+		m_CurrentToneMapper = ToneMapper::MaxToOne;
+		break;
+	}
+
+	PresentBuffer();
+}
+
+void Renderer::ToggleSRGB()
+{
+	m_SRGBEnabled = !m_SRGBEnabled;
+	PresentBuffer();
+}
+
+void Renderer::ToggleDenoiser()
+{
+	m_DenoiserEnabled = !m_DenoiserEnabled;
+	std::cout << "Denoiser: " << (m_DenoiserEnabled ? "on" : "off") << std::endl;
+
+	//The feature buffers are always written, filtering the current frame needs no retrace
+	PresentBuffer();
+}
+
+void Renderer::ToggleBRDFPrecomputation()
+{
+	Material_CookTorrence::SetPrecomputedEvaluation(!Material_CookTorrence::IsPrecomputedEvaluation());
+	std::cout << "Cook-Torrance: " << (Material_CookTorrence::IsPrecomputedEvaluation() ? "precomputed" : "analytic") << std::endl;
+	m_IsFrameValid = false;
+}
+
+bool Renderer::IsPixelConverged(uint32_t pixelIdx) const
+{
+	const uint32_t numSamples{ m_SampleCountBuffer[pixelIdx] };
+	if (numSamples >= m_MaxSamples)
+		return true;
+
+	//Reprojected history looks like many samples but may be stale (view dependent shading), only traced samples count
+	if (!m_AdaptiveEnabled || m_FreshSampleCountBuffer[pixelIdx] < m_MinAdaptiveSamples)
+		return false;
+
+	//Standard error of the mean luminance, relative to the mean (with a floor so dark pixels don't sample forever)
+	const float invNumSamples{ 1.f / float(numSamples) };
+	const float mean{ m_AccumulationBuffer[pixelIdx].Luminance() * invNumSamples };
+	const float variance{ std::max(0.f, m_LuminanceSqBuffer[pixelIdx] * invNumSamples - mean * mean) };
+	const float standardError{ sqrtf(variance * invNumSamples) };
+
+	return standardError <= m_AdaptiveThreshold * std::max(mean, 0.1f);
+}
+
+void Renderer::BuildShadingRates()
+{
+	//Classifies every tile of the last frame, it is close enough to the new view to predict where detail is
+	m_ShadingRateWidth = m_RenderWidth;
+	m_ShadingRateHeight = m_RenderHeight;
+	m_NumRateTilesX = (m_RenderWidth + SHADING_RATE_TILE_SIZE - 1) / SHADING_RATE_TILE_SIZE;
+	const int numRateTilesY{ (m_RenderHeight + SHADING_RATE_TILE_SIZE - 1) / SHADING_RATE_TILE_SIZE };
+	m_ShadingRates.resize(size_t(m_NumRateTilesX) * numRateTilesY);
+
+	const float invDiagonal{ 1.f / sqrtf(float(m_RenderWidth * m_RenderWidth + m_RenderHeight * m_RenderHeight)) };
+
+	concurrency::parallel_for(0, numRateTilesY, [&](int tileY)
+		{
+			for (int tileX{ 0 }; tileX < m_NumRateTilesX; ++tileX)
+			{
+				const int startX{ tileX * SHADING_RATE_TILE_SIZE };
+				const int startY{ tileY * SHADING_RATE_TILE_SIZE };
+				const int endX{ std::min(startX + SHADING_RATE_TILE_SIZE, m_RenderWidth) };
+				const int endY{ std::min(startY + SHADING_RATE_TILE_SIZE, m_RenderHeight) };
+
+				//Focus point, full rate inside the fovea
+				const float centerX{ (float(startX + endX) * 0.5f) / float(m_RenderWidth) - m_FocusPointX };
+				const float centerY{ (float(startY + endY) * 0.5f) / float(m_RenderHeight) - m_FocusPointY };
+				const float focusDistance{ sqrtf(Square(centerX * float(m_RenderWidth)) + Square(centerY * float(m_RenderHeight))) * invDiagonal };
+				uint8_t& rate{ m_ShadingRates[size_t(tileY) * m_NumRateTilesX + tileX] };
+				if (focusDistance < m_FoveaRadius)
+				{
+					rate = 1;
+					continue;
+				}
+
+				//Edges (silhouettes, creases) need full rate, lighting gradients half rate, flat tiles quarter rate
+				const size_t firstIdx{ size_t(startY) * m_RenderWidth + startX };
+				const bool isFirstBackground{ m_DepthBuffer[firstIdx] == FLT_MAX };
+				const Vector3& firstNormal{ m_NormalBuffer[firstIdx] };
+				float minDepth{ FLT_MAX }, maxDepth{ 0.f };
+				float minLuminance{ FLT_MAX }, maxLuminance{ 0.f };
+				bool hasEdge{ false };
+				for (int y{ startY }; y < endY && !hasEdge; ++y)
+				{
+					for (int x{ startX }; x < endX; ++x)
+					{
+						const size_t pixelIdx{ size_t(y) * m_RenderWidth + x };
+						const float depth{ m_DepthBuffer[pixelIdx] };
+						if ((depth == FLT_MAX) != isFirstBackground
+							|| (!isFirstBackground && Vector3::Dot(firstNormal, m_NormalBuffer[pixelIdx]) < m_RateNormalThreshold))
+						{
+							hasEdge = true;
+							break;
+						}
+
+						const float luminance{ GetPixelRadiance(pixelIdx).Luminance() };
+						minLuminance = std::min(minLuminance, luminance);
+						maxLuminance = std::max(maxLuminance, luminance);
+						if (!isFirstBackground)
+						{
+							minDepth = std::min(minDepth, depth);
+							maxDepth = std::max(maxDepth, depth);
+						}
+					}
+				}
+
+				if (!hasEdge && !isFirstBackground)
+					hasEdge = maxDepth - minDepth > m_RateDepthThreshold * minDepth;
+
+				if (hasEdge)
+					rate = 1;
+				else if (maxLuminance - minLuminance > m_RateContrastThreshold * std::max(maxLuminance, 0.1f))
+					rate = 2;
+				else
+					rate = 4;
+
+				//Periphery never gets full rate
+				if (focusDistance > m_PeripheryRadius)
+					rate = std::max(rate, uint8_t(2));
+			}
+		});
+}
+
+bool Renderer::IsPixelTraced(int px, int py) const
+{
+	const uint8_t rate{ m_ShadingRates[size_t(py / SHADING_RATE_TILE_SIZE) * m_NumRateTilesX + px / SHADING_RATE_TILE_SIZE] };
+	return px % rate == 0 && py % rate == 0;
+}
+
+void Renderer::InterpolateSkippedPixels()
+{
+	m_NumInterpolatedPixels = 0;
+
+	concurrency::parallel_for(0, m_RenderHeight, [&](int py)
+		{
+			uint32_t numInterpolated{ 0 };
+			for (int px{ 0 }; px < m_RenderWidth; ++px)
+			{
+				if (IsPixelTraced(px, py))
+					continue;
+
+				//Bilinear between the traced corners of the pixel's block, the top left one is always traced
+				const int rate{ m_ShadingRates[size_t(py / SHADING_RATE_TILE_SIZE) * m_NumRateTilesX + px / SHADING_RATE_TILE_SIZE] };
+				const int x0{ px - px % rate };
+				const int y0{ py - py % rate };
+				const int x1{ std::min(x0 + rate, m_RenderWidth - 1) };
+				const int y1{ std::min(y0 + rate, m_RenderHeight - 1) };
+				const float fx{ float(px - x0) / float(rate) };
+				const float fy{ float(py - y0) / float(rate) };
+
+				const int cornersX[4]{ x0, x1, x0, x1 };
+				const int cornersY[4]{ y0, y0, y1, y1 };
+				const float weights[4]{ (1.f - fx) * (1.f - fy), fx * (1.f - fy), (1.f - fx) * fy, fx * fy };
+
+				ColorRGB color{};
+				float weightSum{ 0.f };
+				for (int corner{ 0 }; corner < 4; ++corner)
+				{
+					if (weights[corner] <= 0.f || !IsPixelTraced(cornersX[corner], cornersY[corner]))
+						continue; //the neighbouring tile may be coarser
+
+					//Means, a traced corner also holds its reprojected history samples
+					const size_t cornerIdx{ size_t(cornersY[corner]) * m_RenderWidth + cornersX[corner] };
+					const float cornerWeight{ weights[corner] / float(std::max(m_SampleCountBuffer[cornerIdx], 1u)) };
+					color += cornerWeight * m_AccumulationBuffer[cornerIdx];
+					weightSum += weights[corner];
+				}
+				color *= 1.f / weightSum;
+
+				//Stored as a single sample estimate with a count of 0, the next refinement pass overwrites it
+				const size_t pixelIdx{ size_t(py) * m_RenderWidth + px };
+				const size_t anchorIdx{ size_t(y0) * m_RenderWidth + x0 };
+				const float luminance{ color.Luminance() };
+				m_AccumulationBuffer[pixelIdx] = color;
+				m_LuminanceSqBuffer[pixelIdx] = luminance * luminance;
+				m_AlbedoBuffer[pixelIdx] = m_AlbedoBuffer[anchorIdx];
+				m_NormalBuffer[pixelIdx] = m_NormalBuffer[anchorIdx];
+				m_DepthBuffer[pixelIdx] = m_DepthBuffer[anchorIdx];
+				++numInterpolated;
+			}
+
+			m_NumInterpolatedPixels.fetch_add(numInterpolated, std::memory_order_relaxed);
+			m_NumActivePixels.fetch_add(numInterpolated, std::memory_order_relaxed);
+		});
+}
+
+void Renderer::ToggleVariableRate()
+{
+	m_VariableRateEnabled = !m_VariableRateEnabled;
+	m_NumInterpolatedPixels = 0;
+	std::cout << "Variable rate tracing: " << (m_VariableRateEnabled ? "on" : "off") << std::endl;
+}
+
+bool Renderer::ReprojectHistory(uint32_t pixelIdx, const HitRecord& hit, uint32_t& numSamples)
+{
+	//Project the hit point with the previous camera, the inverse of the CameraRayTable mapping
+	const ViewState& view{ m_PreviousView };
+	const Vector3 toPoint{ hit.origin - view.origin };
+	const float viewZ{ Vector3::Dot(toPoint, view.forward) };
+	if (viewZ <= 0.f)
+		return false;
+
+	const float x{ Vector3::Dot(toPoint, view.right) / (viewZ * view.aspectRatio * view.fov) };
+	const float y{ Vector3::Dot(toPoint, view.up) / (viewZ * view.fov) };
+	const int px{ int(floorf((x + 1.f) * 0.5f * float(view.width))) };
+	const int py{ int(floorf((1.f - y) * 0.5f * float(view.height))) };
+	if (px < 0 || px >= view.width || py < 0 || py >= view.height)
+		return false;
+
+	//Disocclusion, the previous pixel saw a different surface (or nothing)
+	const size_t historyIdx{ size_t(py) * view.width + px };
+	const float historyDepth{ m_HistoryDepthBuffer[historyIdx] };
+	const float distance{ toPoint.Magnitude() };
+	if (historyDepth == FLT_MAX || std::abs(historyDepth - distance) > m_ReprojectionDepthTolerance * distance)
+		return false;
+	if (Vector3::Dot(hit.normal, m_HistoryNormalBuffer[historyIdx]) < m_ReprojectionNormalTolerance)
+		return false;
+
+	const uint32_t historySamples{ m_HistorySampleCountBuffer[historyIdx] };
+	if (historySamples == 0)
+		return false;
+
+	//A history pixel of a lower render scale covered several of the current pixels, it is worth proportionally fewer samples
+	const float areaRatio{ std::min(1.f, float(view.width) * float(view.height) / (float(m_RenderWidth) * float(m_RenderHeight))) };
+	const uint32_t maxHistorySamples{ std::max(1u, uint32_t(float(m_MaxHistorySamples) * areaRatio + 0.5f)) };
+
+	//Keep at most that much of the history, scaled so the average is unchanged
+	const uint32_t keptSamples{ std::min(historySamples, maxHistorySamples) };
+	const float scale{ float(keptSamples) / float(historySamples) };
+	const ColorRGB& historyColor{ m_HistoryAccumulationBuffer[historyIdx] };
+	m_AccumulationBuffer[pixelIdx] += historyColor * scale;
+	m_LuminanceSqBuffer[pixelIdx] += m_HistoryLuminanceSqBuffer[historyIdx] * scale;
+	numSamples += keptSamples;
+	return true;
+}
+
+void Renderer::ToggleTemporalReprojection()
+{
+	m_TemporalEnabled = !m_TemporalEnabled;
+	std::cout << "Temporal reprojection: " << (m_TemporalEnabled ? "on" : "off") << std::endl;
+}
+
+void Renderer::PresentBuffer()
+{
+	if (m_DenoiserEnabled)
+		DenoiseBuffer();
+	ResolveBuffer();
+	SDL_UpdateWindowSurface(m_pWindow);
+}
+
+ColorRGB Renderer::GetPixelRadiance(size_t pixelIdx) const
+{
+	if (m_DenoiserEnabled)
+		return m_DenoisedBuffer[pixelIdx];
+
+	const ColorRGB& accumulatedColor{ m_AccumulationBuffer[pixelIdx] };
+	return accumulatedColor * (1.f / float(std::max(m_SampleCountBuffer[pixelIdx], 1u)));
+}
+
+ColorRGB Renderer::GetDisplayRadiance(int px, int py) const
+{
+	if (m_RenderWidth == m_Width && m_RenderHeight == m_Height)
+		return GetPixelRadiance(size_t(py) * m_Width + px);
+
+	//Bilinear upsample, window pixel centers mapped onto the render resolution
+	const float x{ (float(px) + 0.5f) * float(m_RenderWidth) / float(m_Width) - 0.5f };
+	const float y{ (float(py) + 0.5f) * float(m_RenderHeight) / float(m_Height) - 0.5f };
+	const int x0{ std::clamp(int(floorf(x)), 0, m_RenderWidth - 1) };
+	const int y0{ std::clamp(int(floorf(y)), 0, m_RenderHeight - 1) };
+	const int x1{ std::min(x0 + 1, m_RenderWidth - 1) };
+	const int y1{ std::min(y0 + 1, m_RenderHeight - 1) };
+	const float fx{ std::clamp(x - float(x0), 0.f, 1.f) };
+	const float fy{ std::clamp(y - float(y0), 0.f, 1.f) };
+
+	const ColorRGB topLeft{ GetPixelRadiance(size_t(y0) * m_RenderWidth + x0) };
+	const ColorRGB topRight{ GetPixelRadiance(size_t(y0) * m_RenderWidth + x1) };
+	const ColorRGB bottomLeft{ GetPixelRadiance(size_t(y1) * m_RenderWidth + x0) };
+	const ColorRGB bottomRight{ GetPixelRadiance(size_t(y1) * m_RenderWidth + x1) };
+	const ColorRGB top{ topLeft * (1.f - fx) + topRight * fx };
+	const ColorRGB bottom{ bottomLeft * (1.f - fx) + bottomRight * fx };
+	return top * (1.f - fy) + bottom * fy;
+}
+
+void Renderer::DenoiseBuffer()
+{
+	//Tonemapper, sRGB or display mode changes only resolve again, the filtered buffer is still valid
+	if (!m_HasNewSamples)
+		return;
+	m_HasNewSamples = false;
+
+	//Average in place, the denoiser only reads its input before the first write
+	concurrency::parallel_for(0, m_RenderHeight, [&](int py)
+		{
+			const size_t rowStart{ size_t(py) * m_RenderWidth };
+			for (size_t pixelIdx{ rowStart }; pixelIdx < rowStart + m_RenderWidth; ++pixelIdx)
+			{
+				const ColorRGB& accumulatedColor{ m_AccumulationBuffer[pixelIdx] };
+				m_DenoisedBuffer[pixelIdx] = accumulatedColor * (1.f / float(std::max(m_SampleCountBuffer[pixelIdx], 1u)));
+			}
+		});
+
+	m_Denoiser.Apply(m_RenderWidth, m_RenderHeight, m_DenoisedBuffer.data(), m_AlbedoBuffer.data(), m_NormalBuffer.data(),
+		m_DepthBuffer.data(), m_DenoisedBuffer.data());
+}
+
+void Renderer::ResolveBuffer()
+{
+	const SDL_PixelFormat* pFormat{ m_pBuffer->format };
+	const auto& sRGBTable{ ToneMapping::GetSRGBTable() };
+	const bool isColorDisplay{ m_CurrentDisplayMode == DisplayMode::Color };
+	const bool encodeSRGB{ m_SRGBEnabled && isColorDisplay };
+
+	//Row by row, every stage is a tight loop over contiguous memory
+	concurrency::parallel_for(0, m_Height, [&](int py)
+		{
+			const size_t rowStart{ size_t(py) * m_Width };
+			const size_t numChannels{ size_t(m_Width) * 3 };
+			float* pRow{ m_ResolveBuffer.data() + rowStart * 3 };
+
+			//1. Average + exposure (or the samples per pixel diagnostic)
+			for (size_t px{ 0 }; px < size_t(m_Width); ++px)
+			{
+				float* pPixel{ pRow + px * 3 };
+
+				if (isColorDisplay)
+				{
+					const ColorRGB radiance{ GetDisplayRadiance(int(px), py) };
+					pPixel[0] = radiance.r * m_Exposure;
+					pPixel[1] = radiance.g * m_Exposure;
+					pPixel[2] = radiance.b * m_Exposure;
+				}
+				else
+				{
+					//Nearest render pixel
+					const size_t renderX{ px * m_RenderWidth / m_Width };
+					const size_t renderY{ size_t(py) * m_RenderHeight / m_Height };
+					const uint32_t numSamples{ m_SampleCountBuffer[renderY * m_RenderWidth + renderX] };
+					const float t{ std::min(float(numSamples) / float(m_MaxSamples), 1.f) };
+					pPixel[0] = t;
+					pPixel[1] = 1.f - abs(2.f * t - 1.f);
+					pPixel[2] = 1.f - t;
+				}
+			}
+
+			//2. Tonemap in bulk
+			if (isColorDisplay)
+			{
+				switch (m_CurrentToneMapper)
+				{
+				case ToneMapper::MaxToOne:
+					ToneMapping::MaxToOne(pRow, numChannels);
+					break;
+				case ToneMapper::Reinhard:
+					ToneMapping::Reinhard(pRow, numChannels);
+					break;
+				case ToneMapper::ACES:
+					ToneMapping::ACES(pRow, numChannels);
+					break;
+				}
+			}
+
+			//3. Encode + pack into the surface format (same result as SDL_MapRGB for 32 bit surfaces)
+			for (size_t px{ 0 }; px < size_t(m_Width); ++px)
+			{
+				uint8_t channels[3]{};
+				for (int c{ 0 }; c < 3; ++c)
+				{
+					//NaN fails the comparison and maps to black, std::min/std::max would pass it on to the table index
+					const float channel{ pRow[px * 3 + c] };
+					const float value{ channel >= 0.f ? std::min(channel, 1.f) : 0.f };
+					channels[c] = encodeSRGB ?
+						sRGBTable[size_t(value * (ToneMapping::SRGB_TABLE_SIZE - 1) + 0.5f)] :
+						static_cast<uint8_t>(value * 255);
+				}
+
+				m_pBufferPixels[rowStart + px] =
+					(uint32_t(channels[0] >> pFormat->Rloss) << pFormat->Rshift) |
+					(uint32_t(channels[1] >> pFormat->Gloss) << pFormat->Gshift) |
+					(uint32_t(channels[2] >> pFormat->Bloss) << pFormat->Bshift) |
+					pFormat->Amask;
+			}
+		});
+}
+
+void Renderer::RenderPixel(Scene* pScene, uint32_t pixelIdx, const Camera& camera,
+							const std::vector<Light>& lights, const std::vector<Material*>& materials)
+{
+	const int px{ int(pixelIdx) % m_RenderWidth };
+	const int py{ int(pixelIdx) / m_RenderWidth };
+
+	uint32_t& numSamples{ m_SampleCountBuffer[pixelIdx] };
+	if (m_AccumulationPass == 0)
+	{
+		numSamples = 0;
+		m_FreshSampleCountBuffer[pixelIdx] = 0;
+		if (m_IsVariableRatePass && !IsPixelTraced(px, py))
+			return; //filled in by InterpolateSkippedPixels
+	}
+	else if (IsPixelConverged(pixelIdx))
+		return;
+
+	//First sample goes through the pixel center, the following ones are jittered inside the pixel
+	float jitterX{ 0.5f };
+	float jitterY{ 0.5f };
+	if (numSamples > 0)
+	{
+		uint32_t seed{ Hash(pixelIdx ^ Hash(numSamples)) };
+		jitterX = RandomFloat(seed);
+		jitterY = RandomFloat(seed);
+	}
+
+	const Vector3 rayDirection{ numSamples > 0 ?
+		m_CameraRays.GetJitteredDirection(pixelIdx, jitterX, jitterY) : m_CameraRays.GetDirection(pixelIdx) };
 
 	const Ray viewRay{ camera.origin, rayDirection };
 	ColorRGB finalColor{};
+	ShadowRayCounts shadowRays{};
 	HitRecord closestHit{};
-	pScene->GetClosestHit(viewRay, closestHit);
 
-	if (closestHit.didHit)
+	if (m_CurrentIntegrator == Integrator::PathTracing && m_CurrentLightingMode == LightingMode::Combined)
+	{
+		finalColor = TracePath(pScene, viewRay, pixelIdx, numSamples, lights, materials, shadowRays, closestHit);
+	}
+	else
+	{
+		pScene->GetClosestHit(viewRay, closestHit);
+
+		if (closestHit.didHit)
+		{
+			closestHit.footprint = m_CameraRays.GetFootprint(rayDirection, closestHit.normal, closestHit.t);
+
+			uint32_t lightSeed{ Hash(pixelIdx ^ Hash(numSamples ^ 0x9E3779B9u)) };
+
+			//Area light samples continue the pixel's R2 sequence every frame, shifted per pixel
+			uint32_t shiftSeed{ Hash(pixelIdx ^ 0x68E31DA4u) };
+			ShadingContext context{ pScene, closestHit, rayDirection, materials };
+			context.sampleIndex = numSamples;
+			context.shiftU = RandomFloat(shiftSeed);
+			context.shiftV = RandomFloat(shiftSeed);
+
+			finalColor = ShadeDirect(lights, lightSeed, context);
+			shadowRays = context.shadowRays;
+		}
+		else if (const EnvironmentMap* pEnvironment{ pScene->GetEnvironment() })
+			finalColor = pEnvironment->GetRadiance(rayDirection);
+	}
+
+	//One atomic add per pixel instead of one per light
+	if (shadowRays.traced > 0)
+		m_NumShadowRaysTraced.fetch_add(shadowRays.traced, std::memory_order_relaxed);
+	if (shadowRays.skipped > 0)
+		m_NumShadowRaysSkipped.fetch_add(shadowRays.skipped, std::memory_order_relaxed);
+
+	//Accumulate, then display the running average
+	const float luminance{ finalColor.Luminance() };
+	if (numSamples == 0)
+	{
+		//Denoiser features come from the pixel center sample, they don't change while accumulating
+		m_AlbedoBuffer[pixelIdx] = closestHit.didHit ? materials[closestHit.materialIndex]->GetAlbedo(closestHit) : colors::White;
+		m_NormalBuffer[pixelIdx] = closestHit.normal;
+		m_DepthBuffer[pixelIdx] = closestHit.didHit ? closestHit.t : FLT_MAX;
+
+		m_AccumulationBuffer[pixelIdx] = finalColor;
+		m_LuminanceSqBuffer[pixelIdx] = luminance * luminance;
+	}
+	else
+	{
+		m_AccumulationBuffer[pixelIdx] += finalColor;
+		m_LuminanceSqBuffer[pixelIdx] += luminance * luminance;
+	}
+
+	if (m_IsReprojecting && closestHit.didHit && ReprojectHistory(pixelIdx, closestHit, numSamples))
+		m_NumReprojectedPixels.fetch_add(1, std::memory_order_relaxed);
+	++numSamples;
+	++m_FreshSampleCountBuffer[pixelIdx];
+
+	if (!IsPixelConverged(pixelIdx))
+		m_NumActivePixels.fetch_add(1, std::memory_order_relaxed);
+}
+
+ColorRGB Renderer::ShadeDirect(const std::vector<Light>& lights, uint32_t& lightSeed, ShadingContext& context) const
+{
+	const LightTree& lightTree{ context.pScene->GetLightTree() };
+	const LightGrid& lightGrid{ context.pScene->GetLightGrid() };
+
+	ColorRGB color{};
+	if (m_LightCullingEnabled && !lightGrid.IsEmpty())
+	{
+		//Only the lights whose influence sphere overlaps this cell can contribute
+		for (const uint32_t lightIndex : lightGrid.GetGlobalLights())
+			color += ShadeLight(lights[lightIndex], 1.f, context);
+
+		const std::span<const uint32_t> nearbyLights{ lightGrid.GetLights(context.hit.origin) };
+		if (!m_ManyLightSamplingEnabled || nearbyLights.size() <= m_MaxExhaustiveLights)
+		{
+			for (const uint32_t lightIndex : nearbyLights)
+				color += ShadeLight(lights[lightIndex], 1.f, context);
+		}
+		else
+			color += SampleCellLights(lights, nearbyLights, lightSeed, context);
+	}
+	else if (!m_ManyLightSamplingEnabled || lightTree.GetNumPointLights() <= m_MaxExhaustiveLights)
 	{
 		for (const dae::Light& light : lights) //loop all lights
+			color += ShadeLight(light, 1.f, context);
+	}
+	else
+	{
+		//Directional and area lights are few, shade them all
+		for (const uint32_t lightIndex : lightTree.GetGlobalLights())
+			color += ShadeLight(lights[lightIndex], 1.f, context);
+
+		color += SampleLightTree(lights, lightSeed, context);
+	}
+
+	if (const EnvironmentMap* pEnvironment{ context.pScene->GetEnvironment() })
+		color += ShadeEnvironment(*pEnvironment, context);
+	return color;
+}
+
+ColorRGB Renderer::TracePath(Scene* pScene, const Ray& viewRay, uint32_t pixelIdx, uint32_t numSamples,
+							const std::vector<Light>& lights, const std::vector<Material*>& materials, ShadowRayCounts& shadowRays, HitRecord& primaryHit)
+{
+	uint32_t pathSeed{ Hash(pixelIdx ^ Hash(numSamples ^ 0x85EBCA6Bu)) };
+
+	ColorRGB radiance{};
+	ColorRGB throughput{ 1.f, 1.f, 1.f };
+	Ray ray{ viewRay };
+	Vector3 previousOrigin{ viewRay.origin };
+	float previousPdf{ 0.f }; //BSDF pdf of the bounce that produced ray
+
+	uint32_t numBounces{ 0 };
+	bool isRouletteTerminated{ false };
+	float footprint{ 0.f }; //texture footprint at the previous vertex
+	for (uint32_t depth{ 0 }; depth <= m_MaxBounces; ++depth)
+	{
+		HitRecord hit{};
+		pScene->GetClosestHit(ray, hit);
+
+		//Area lights in front of the surface, bounce rays are weighted against next event estimation (MIS)
+		Ray lightRay{ ray };
+		lightRay.max = hit.t;
+		uint32_t lightIndex{};
+		float lightT{};
+		if (pScene->HitTestAreaLights(lightRay, lightIndex, lightT))
 		{
-			const Vector3 startPoint{ closestHit.origin + closestHit.normal * 0.01f }; //the point that just got hit
-			const Vector3 direction{ LightUtils::GetDirectionToLight(light, startPoint) }; //vector from hit point to light
-			Ray lightRay{ startPoint, direction }; //calculate the light ray
-			lightRay.max = lightRay.direction.Normalize();
-			const float lambertLaw{ Vector3::Dot(closestHit.normal, direction.Normalized()) };
+			const Light& light{ lights[lightIndex] };
+			ColorRGB emitted{ light.color * light.intensity };
+			if (depth > 0)
+			{
+				const float lightPdf{ LightUtils::GetLightPdf(light, previousOrigin, ray.direction, lightT) };
+				emitted *= Sampling::PowerHeuristic(1.f, previousPdf, float(std::max(light.numSamples, 1u)), lightPdf);
+			}
+			emitted *= throughput;
+			radiance += emitted;
+			break;
+		}
 
-			if (pScene->DoesHit(lightRay) && m_ShadowsEnabled)
-				continue;
+		if (!hit.didHit)
+		{
+			//Escaped to the environment, bounce rays are weighted against its next event estimation
+			if (const EnvironmentMap* pEnvironment{ pScene->GetEnvironment() })
+			{
+				ColorRGB environment{ pEnvironment->GetRadiance(ray.direction) };
+				if (depth > 0)
+				{
+					const float environmentPdf{ pEnvironment->GetPdf(ray.direction) };
+					environment *= Sampling::PowerHeuristic(1.f, previousPdf, float(m_EnvironmentSamples), environmentPdf);
+				}
+				environment *= throughput;
+				radiance += environment;
+			}
+			break;
+		}
+
+		//Exact ray differentials for the camera ray, a cone with the pixel spread angle after that
+		if (depth == 0)
+			footprint = m_CameraRays.GetFootprint(ray.direction, hit.normal, hit.t);
+		else
+			footprint += m_CameraRays.GetSpreadAngle() * hit.t;
+		hit.footprint = footprint;
+
+		if (depth == 0)
+			primaryHit = hit;
+
+		Material* pMaterial{ materials[hit.materialIndex] };
+
+		//Next event estimation, the same light loop as direct lighting at every vertex
+		uint32_t lightSeed{ Hash(pathSeed ^ depth) };
+		uint32_t shiftSeed{ Hash(pixelIdx ^ Hash(depth ^ 0x68E31DA4u)) };
+		ShadingContext context{ pScene, hit, ray.direction, materials };
+		context.sampleIndex = numSamples;
+		context.shiftU = RandomFloat(shiftSeed);
+		context.shiftV = RandomFloat(shiftSeed);
+		context.useMIS = true;
+
+		ColorRGB direct{ ShadeDirect(lights, lightSeed, context) };
+		direct *= throughput;
+		radiance += direct;
+		shadowRays.traced += context.shadowRays.traced;
+		shadowRays.skipped += context.shadowRays.skipped;
 
-			const ColorRGB radiance{ LightUtils::GetRadiance(light, startPoint) };
-			const ColorRGB brdf{ materials[closestHit.materialIndex]->Shade(closestHit, lightRay.direction, -rayDirection) };
+		if (depth == m_MaxBounces)
+			break;
 
-			switch (m_CurrentLightingMode)
+		//Continue the path in a direction importance sampled from the BRDF
+		const Vector3 view{ -ray.direction };
+		Vector3 direction{};
+		const float pdf{ pMaterial->Sample(hit, view, RandomFloat(pathSeed), RandomFloat(pathSeed), RandomFloat(pathSeed), direction) };
+		const float cosine{ Vector3::Dot(hit.normal, direction) };
+		if (pdf <= 0.f || cosine <= 0.f)
+			break;
+
+		ColorRGB brdf{ pMaterial->Shade(hit, direction, view) };
+		brdf *= cosine / pdf;
+		throughput *= brdf;
+
+		//Russian roulette, dim paths are terminated early and the survivors weighted up
+		if (depth + 1 >= m_RussianRouletteDepth)
+		{
+			const float survival{ std::min(std::max(throughput.r, std::max(throughput.g, throughput.b)), 0.95f) };
+			if (RandomFloat(pathSeed) >= survival)
 			{
-			case LightingMode::ObservedArea:
-				if (lambertLaw > 0)
-					finalColor += {lambertLaw, lambertLaw, lambertLaw};
-				break;
-			case LightingMode::Radiance:
-				finalColor += radiance;
-				break;
-			case LightingMode::BRDF:
-				finalColor += brdf;
-				break;
-			case LightingMode::Combined:
-				if (lambertLaw > 0)
-					finalColor += radiance * brdf * lambertLaw;
+				isRouletteTerminated = true;
 				break;
 			}
+			throughput *= 1.f / survival;
+		}
+
+		previousOrigin = hit.origin;
+		previousPdf = pdf;
+		ray = Ray{ hit.origin + hit.normal * 0.01f, direction };
+		++numBounces;
+	}
+
+	//Per path statistics, histogram of the number of bounces
+	m_NumPaths.fetch_add(1, std::memory_order_relaxed);
+	m_NumPathBounces.fetch_add(numBounces, std::memory_order_relaxed);
+	m_PathLengthHistogram[std::min(numBounces, MAX_PATH_BOUNCES)].fetch_add(1, std::memory_order_relaxed);
+	if (isRouletteTerminated)
+		m_NumRouletteTerminations.fetch_add(1, std::memory_order_relaxed);
+
+	return radiance;
+}
+
+PathStatistics Renderer::GetPathStatistics() const
+{
+	PathStatistics statistics{};
+	statistics.numPaths = m_NumPaths;
+	statistics.numBounces = m_NumPathBounces;
+	statistics.numRouletteTerminations = m_NumRouletteTerminations;
+	for (uint32_t i{ 0 }; i <= MAX_PATH_BOUNCES; ++i)
+		statistics.pathLengths[i] = m_PathLengthHistogram[i];
+	return statistics;
+}
+
+void Renderer::CycleIntegrator()
+{
+	m_IsFrameValid = false;
+
+	switch (m_CurrentIntegrator)
+	{
+	case Integrator::DirectLighting:
+		m_CurrentIntegrator = Integrator::PathTracing;
+		std::cout << "Integrator: path tracing (" << m_MaxBounces << " bounces)" << std::endl;
+		break;
+	case Integrator::PathTracing:
+		m_CurrentIntegrator = Integrator::DirectLighting;
+		std::cout << "Integrator: direct lighting" << std::endl;
+		break;
+	}
+}
+
+ColorRGB Renderer::SampleLightTree(const std::vector<Light>& lights, uint32_t& seed, ShadingContext& context) const
+{
+	//A few picks from the light tree, each weighted by 1 / (pdf * picks) so the sum stays unbiased
+	const LightTree& lightTree{ context.pScene->GetLightTree() };
+	const float sampleWeight{ 1.f / float(m_LightSamplesPerHit) };
+
+	ColorRGB color{};
+	for (uint32_t sampleIdx{ 0 }; sampleIdx < m_LightSamplesPerHit; ++sampleIdx)
+	{
+		const LightTree::LightSample lightSample{ lightTree.Sample(context.hit.origin, context.hit.normal, RandomFloat(seed)) };
+		if (lightSample.pdf <= 0.f)
+			continue;
+
+		color += ShadeLight(lights[lightSample.lightIndex], sampleWeight / lightSample.pdf, context);
+	}
+	return color;
+}
+
+ColorRGB Renderer::SampleCellLights(const std::vector<Light>& lights, std::span<const uint32_t> cellLights, uint32_t& seed, ShadingContext& context) const
+{
+	//The light tree's leaf estimate (power * cosine / squared distance), lights behind the surface are never picked
+	const auto getImportance = [&](const Light& light)
+	{
+		const Vector3 toLight{ light.origin - context.hit.origin };
+		const float sqrDistance{ toLight.SqrMagnitude() };
+		const float cosine{ Vector3::Dot(context.hit.normal, toLight) };
+		if (cosine <= 0.f)
+			return 0.f;
+		return light.intensity * light.color.Luminance() * cosine / (sqrtf(sqrDistance) * std::max(sqrDistance, 1e-4f));
+	};
+
+	float totalImportance{ 0.f };
+	for (const uint32_t lightIndex : cellLights)
+		totalImportance += getImportance(lights[lightIndex]);
+	if (totalImportance <= 0.f)
+		return {};
+
+	//Stratified targets along the cumulative importance, so one walk over the list makes every pick.
+	//Each pick is weighted by 1 / (probability * picks), like the tree samples
+	const float sampleWeight{ 1.f / float(m_LightSamplesPerHit) };
+	uint32_t sampleIdx{ 0 };
+	float target{ RandomFloat(seed) * sampleWeight * totalImportance };
+	float cumulativeImportance{ 0.f };
+
+	ColorRGB color{};
+	for (const uint32_t lightIndex : cellLights)
+	{
+		const Light& light{ lights[lightIndex] };
+		const float importance{ getImportance(light) };
+		cumulativeImportance += importance;
+		while (sampleIdx < m_LightSamplesPerHit && target < cumulativeImportance)
+		{
+			color += ShadeLight(light, sampleWeight * totalImportance / importance, context);
+			++sampleIdx;
+			target = (float(sampleIdx) + RandomFloat(seed)) * sampleWeight * totalImportance;
+		}
+	}
+	return color;
+}
+
+ColorRGB Renderer::ShadeLight(const Light& light, float weight, ShadingContext& context) const
+{
+	const HitRecord& closestHit{ context.hit };
+	const Vector3 startPoint{ closestHit.origin + closestHit.normal * 0.01f }; //the point that just got hit
+
+	//Out of reach, no shadow ray needed
+	if (light.type == LightType::Point && (light.origin - startPoint).SqrMagnitude() >= light.influenceRadius * light.influenceRadius)
+	{
+		++context.shadowRays.skipped;
+		return {};
+	}
+
+	//Area lights take numSamples stratified points per frame, point and directional lights a single one
+	const uint32_t numLightSamples{ light.IsAreaLight() ? std::max(light.numSamples, 1u) : 1u };
+	const float sampleWeight{ weight / float(numLightSamples) };
+
+	ColorRGB color{};
+	for (uint32_t lightSampleIdx{ 0 }; lightSampleIdx < numLightSamples; ++lightSampleIdx)
+	{
+		float u{ 0.f }, v{ 0.f };
+		if (light.IsAreaLight())
+			Sampling::R2(context.sampleIndex * numLightSamples + lightSampleIdx, context.shiftU, context.shiftV, u, v);
+
+		const LightUtils::IncidentLight incident{ LightUtils::SampleLight(light, startPoint, u, v) };
+		const float lambertLaw{ Vector3::Dot(closestHit.normal, incident.direction) };
+		Material* pMaterial{ context.materials[closestHit.materialIndex] };
+
+		//1. Contribution first, every term is much cheaper than the occlusion test
+		ColorRGB contribution{};
+		switch (m_CurrentLightingMode)
+		{
+		case LightingMode::ObservedArea:
+			if (lambertLaw > 0)
+				contribution = { lambertLaw, lambertLaw, lambertLaw };
+			break;
+		case LightingMode::Radiance:
+			contribution = incident.radiance;
+			break;
+		case LightingMode::BRDF:
+			contribution = pMaterial->Shade(closestHit, incident.direction, -context.viewDirection);
+			break;
+		case LightingMode::Combined:
+			//Lights behind the surface need neither BRDF nor shadow ray
+			//The BRDF is only evaluated when the incoming light is a visible amount
+			if (lambertLaw > 0 && incident.radiance.Luminance() * lambertLaw * sampleWeight > m_MinLightContribution)
+			{
+				contribution = incident.radiance * pMaterial->Shade(closestHit, incident.direction, -context.viewDirection);
+				contribution *= lambertLaw;
+			}
+			break;
+		}
+		contribution *= sampleWeight;
+
+		//Path tracing also reaches area lights through BRDF samples, weight both strategies
+		if (context.useMIS && incident.pdf > 0.f)
+		{
+			const float brdfPdf{ pMaterial->Pdf(closestHit, incident.direction, -context.viewDirection) };
+			contribution *= Sampling::PowerHeuristic(float(numLightSamples), incident.pdf, 1.f, brdfPdf);
+		}
+
+		//2. Occlusion last, only for samples that would visibly change the pixel
+		if (contribution.Luminance() <= m_MinLightContribution)
+		{
+			++context.shadowRays.skipped;
+			continue;
+		}
+
+		if (m_ShadowsEnabled)
+		{
+			++context.shadowRays.traced;
+			Ray lightRay{ startPoint, incident.direction };
+			lightRay.max = incident.distance;
+			if (context.pScene->DoesHit(lightRay))
+				continue;
 		}
+
+		color += contribution;
 	}
 
-	//Update Color in Buffer
-	finalColor.MaxToOne();
+	return color;
+}
+
+ColorRGB Renderer::ShadeEnvironment(const EnvironmentMap& environment, ShadingContext& context) const
+{
+	//Only the combined lighting mode shades the environment, the debug modes show the scene lights
+	if (m_CurrentLightingMode != LightingMode::Combined || m_EnvironmentSamples == 0)
+		return {};
+
+	const HitRecord& closestHit{ context.hit };
+	const Vector3 startPoint{ closestHit.origin + closestHit.normal * 0.01f };
+	Material* pMaterial{ context.materials[closestHit.materialIndex] };
+	const float sampleWeight{ 1.f / float(m_EnvironmentSamples) };
+
+	ColorRGB color{};
+	for (uint32_t sampleIdx{ 0 }; sampleIdx < m_EnvironmentSamples; ++sampleIdx)
+	{
+		//Same per pixel sequence as the area lights with the shifts swapped, the two patterns stay uncorrelated
+		float u{}, v{};
+		Sampling::R2(context.sampleIndex * m_EnvironmentSamples + sampleIdx, context.shiftV, context.shiftU, u, v);
+
+		Vector3 direction{};
+		float pdf{};
+		const ColorRGB radiance{ environment.Sample(u, v, direction, pdf) };
+		const float lambertLaw{ Vector3::Dot(closestHit.normal, direction) };
+		if (pdf <= 0.f || lambertLaw <= 0.f)
+		{
+			++context.shadowRays.skipped;
+			continue;
+		}
+
+		ColorRGB contribution{ radiance * pMaterial->Shade(closestHit, direction, -context.viewDirection) };
+		contribution *= lambertLaw * sampleWeight / pdf;
+
+		if (context.useMIS)
+		{
+			const float brdfPdf{ pMaterial->Pdf(closestHit, direction, -context.viewDirection) };
+			contribution *= Sampling::PowerHeuristic(float(m_EnvironmentSamples), pdf, 1.f, brdfPdf);
+		}
+
+		if (contribution.Luminance() <= m_MinLightContribution)
+		{
+			++context.shadowRays.skipped;
+			continue;
+		}
+
+		//Anything in the way blocks the environment
+		if (m_ShadowsEnabled)
+		{
+			++context.shadowRays.traced;
+			if (context.pScene->DoesHit(Ray{ startPoint, direction }))
+				continue;
+		}
+
+		color += contribution;
+	}
 
-	m_pBufferPixels[px + (py * m_Width)] = SDL_MapRGB(m_pBuffer->format,
-		static_cast<uint8_t>(finalColor.r * 255),
-		static_cast<uint8_t>(finalColor.g * 255),
-		static_cast<uint8_t>(finalColor.b * 255));
+	return color;
 }
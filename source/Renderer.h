@@ -1,8 +1,18 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <cstdint>
+#include <span>
 #include <vector>
 
+#include "CameraRayTable.h"
+#include "ColorRGB.h"
+#include "Denoiser.h"
+#include "ImageWriter.h"
+#include "ToneMapping.h"
+
 struct SDL_Window;
 struct SDL_Surface;
 
@@ -11,7 +21,26 @@ namespace dae
 	class Scene;
 	struct Camera; 
 	struct Light;
+	struct HitRecord;
+	struct Ray;
+	struct Vector3;
 	class Material;
+	class EnvironmentMap;
+
+	//Variable rate tracing classifies the image in tiles of this size, rates (1, 2, 4) must divide it
+	constexpr int SHADING_RATE_TILE_SIZE{ 4 };
+
+	//Longest path the bounce statistics distinguish, longer paths are counted in the last bucket
+	constexpr uint32_t MAX_PATH_BOUNCES{ 16 };
+
+	//Path tracer statistics of the last traced frame
+	struct PathStatistics
+	{
+		uint32_t numPaths{ 0 };
+		uint32_t numBounces{ 0 };
+		uint32_t numRouletteTerminations{ 0 };
+		std::array<uint32_t, MAX_PATH_BOUNCES + 1> pathLengths{}; //number of paths per bounce count
+	};
 
 	class Renderer final
 	{
@@ -24,12 +53,67 @@ namespace dae
 		Renderer& operator=(const Renderer&) = delete;
 		Renderer& operator=(Renderer&&) noexcept = delete;
 
-		void Render(Scene* pScene) const;
-		bool SaveBufferToImage() const;
-		void ToggleShadows() { m_ShadowsEnabled = !m_ShadowsEnabled; }
+		//Returns false when the previous frame was reused because nothing changed
+		bool Render(Scene* pScene);
+		//Snapshot of the current frame (display pixels + linear radiance)
+		Image CaptureImage() const;
+		//Both return false if the snapshot was dropped, writing happens on a background thread
+		bool SaveBufferToImage(ImageFormat format = ImageFormat::BMP);
+		bool SaveFrameToSequence(const std::string& baseName, uint32_t frameIndex, ImageFormat format, bool waitIfFull = false);
+		ImageWriter& GetImageWriter() { return m_ImageWriter; }
+		void ToggleShadows() { m_ShadowsEnabled = !m_ShadowsEnabled; m_IsFrameValid = false; }
 		void CycleLightMode();
-		void RenderPixel(Scene* pScene, uint32_t pixelIdx, float fov, float aspectRatio, const Camera& camera, 
-			const std::vector<Light>& lights, const std::vector<Material*>& materials) const;
+		void ToggleProgressive() { m_ProgressiveEnabled = !m_ProgressiveEnabled; m_IsFrameValid = false; }
+		void ToggleAdaptiveSampling() { m_AdaptiveEnabled = !m_AdaptiveEnabled; m_IsFrameValid = false; }
+		void CycleIntegrator();
+		void SetMaxBounces(uint32_t maxBounces) { m_MaxBounces = std::min(maxBounces, MAX_PATH_BOUNCES); m_IsFrameValid = false; }
+		PathStatistics GetPathStatistics() const;
+		bool IsPathTracing() const { return m_CurrentIntegrator == Integrator::PathTracing; }
+		void ToggleLightCulling() { m_LightCullingEnabled = !m_LightCullingEnabled; m_IsFrameValid = false; }
+		void ToggleManyLightSampling() { m_ManyLightSamplingEnabled = !m_ManyLightSamplingEnabled; m_IsFrameValid = false; }
+		void SetProgressive(bool isEnabled) { m_ProgressiveEnabled = isEnabled; m_IsFrameValid = false; }
+		void SetAdaptiveSampling(bool isEnabled) { m_AdaptiveEnabled = isEnabled; m_IsFrameValid = false; }
+		void ToggleTemporalReprojection();
+		void SetTemporalReprojection(bool isEnabled) { m_TemporalEnabled = isEnabled; }
+		//Traces moving views below the window resolution to stay within the budget (enables dynamic resolution)
+		void SetFrameTimeBudget(float milliseconds);
+		void ToggleDynamicResolution();
+		bool IsDynamicResolutionEnabled() const { return m_DynamicResolutionEnabled; }
+		//Fraction of the window resolution the last frame was traced at
+		float GetRenderScale() const { return m_RenderScale; }
+		int GetRenderWidth() const { return m_RenderWidth; }
+		int GetRenderHeight() const { return m_RenderHeight; }
+		//Milliseconds of the last traced frame, tracing + resolve
+		float GetLastFrameTime() const { return m_LastFrameTime; }
+		//Traces one ray per 2x2 or 4x4 block in flat or peripheral tiles of moving views
+		void ToggleVariableRate();
+		void SetVariableRate(bool isEnabled) { m_VariableRateEnabled = isEnabled; }
+		bool IsVariableRateEnabled() const { return m_VariableRateEnabled; }
+		//Full rate region around this point, normalized screen coordinates
+		void SetFocusPoint(float x, float y) { m_FocusPointX = x; m_FocusPointY = y; }
+		//Pixels interpolated instead of traced in the last variable rate pass
+		uint32_t GetNumInterpolatedPixels() const { return m_NumInterpolatedPixels; }
+		//Pixels that kept their history during the last camera move
+		uint32_t GetNumReprojectedPixels() const { return m_NumReprojectedPixels; }
+		//Forces a retrace on the next Render, e.g. when a new scene may reuse the address of a deleted one
+		void InvalidateFrame() { m_IsFrameValid = false; }
+		void CycleDisplayMode();
+		void CycleToneMapper();
+		void ToggleSRGB();
+		void ToggleDenoiser();
+		//Cook-Torrance materials shade with precomputed constants and the DFG table, or with the analytic reference
+		void ToggleBRDFPrecomputation();
+		void SetDenoiser(bool isEnabled) { m_DenoiserEnabled = isEnabled; }
+		void SetExposure(float exposure) { m_Exposure = exposure; }
+		void SetMaxSamples(uint32_t maxSamples) { m_MaxSamples = maxSamples; }
+		//Relative standard error of the pixel luminance at which adaptive sampling stops
+		void SetAdaptiveThreshold(float threshold) { m_AdaptiveThreshold = threshold; }
+		uint32_t GetNumActivePixels() const { return m_NumActivePixels; }
+		//Shadow rays of the last traced frame, skipped = lights culled before the occlusion test
+		uint32_t GetNumShadowRaysTraced() const { return m_NumShadowRaysTraced; }
+		uint32_t GetNumShadowRaysSkipped() const { return m_NumShadowRaysSkipped; }
+		void RenderPixel(Scene* pScene, uint32_t pixelIdx, const Camera& camera,
+			const std::vector<Light>& lights, const std::vector<Material*>& materials);
 
 	private:
 		enum class LightingMode
@@ -40,15 +124,196 @@ namespace dae
 			Combined //observed area * radiance * BRDF
 		};
 
+		enum class Integrator
+		{
+			DirectLighting, //one bounce, shadow rays to the lights
+			PathTracing //next event estimation + BRDF sampled bounces with MIS and russian roulette
+		};
+
+		enum class DisplayMode
+		{
+			Color, //accumulated average
+			SamplesPerPixel //adaptive sampling diagnostic, blue (few) > red (max samples)
+		};
+
 		SDL_Window* m_pWindow{};
 
+		//Primary ray directions, only recomputed when the resolution, fov or camera orientation changes
+		CameraRayTable m_CameraRays{};
+
 		SDL_Surface* m_pBuffer{};
 		uint32_t* m_pBufferPixels{};
 
 		int m_Width{};
 		int m_Height{};
 
+		//Dynamic resolution, the accumulation buffers are window sized but only the first m_RenderWidth * m_RenderHeight
+		//entries are traced (row stride m_RenderWidth), the resolve upsamples them to the window
+		bool m_DynamicResolutionEnabled{ false };
+		float m_FrameTimeBudget{ 33.3f }; //ms
+		float m_MinRenderScale{ 0.25f };
+		float m_TargetRenderScale{ 1.f }; //scale for the next moving frame
+		float m_RenderScale{ 1.f };
+		int m_RenderWidth{};
+		int m_RenderHeight{};
+		float m_LastFrameTime{ 0.f };
+
 		bool m_ShadowsEnabled{ true };
 		LightingMode m_CurrentLightingMode{ LightingMode::Combined };
+
+		//Path tracing, only with the Combined lighting mode
+		Integrator m_CurrentIntegrator{ Integrator::DirectLighting };
+		uint32_t m_MaxBounces{ 4 };
+		uint32_t m_RussianRouletteDepth{ 2 }; //bounces before russian roulette starts
+		std::atomic<uint32_t> m_NumPaths{ 0 };
+		std::atomic<uint32_t> m_NumPathBounces{ 0 };
+		std::atomic<uint32_t> m_NumRouletteTerminations{ 0 };
+		std::array<std::atomic<uint32_t>, MAX_PATH_BOUNCES + 1> m_PathLengthHistogram{};
+
+		//Frame reuse, the buffer is only retraced when one of these changed
+		bool m_IsFrameValid{ false };
+		const Scene* m_pLastScene{ nullptr };
+		uint32_t m_LastSceneVersion{ 0 };
+		uint32_t m_LastCameraVersion{ 0 };
+
+		//Progressive refinement, one jittered sample per pixel is added each frame while the view is still
+		bool m_ProgressiveEnabled{ true };
+		uint32_t m_MaxSamples{ 256 };
+		uint32_t m_AccumulationPass{ 0 };
+		std::vector<ColorRGB> m_AccumulationBuffer{};
+		std::vector<uint32_t> m_SampleCountBuffer{};
+
+		//Temporal reprojection, when only the camera moved the previous accumulation is reused where it still sees the same surface
+		struct ViewState
+		{
+			Vector3 origin{};
+			Vector3 right{};
+			Vector3 up{};
+			Vector3 forward{};
+			float fov{ 1.f };
+			float aspectRatio{ 1.f };
+			int width{ 0 }; //render resolution of the history
+			int height{ 0 };
+		};
+
+		bool m_TemporalEnabled{ true };
+		bool m_IsReprojecting{ false }; //during the first pass after a camera move
+		uint32_t m_MaxHistorySamples{ 8 }; //older samples are dropped so view dependent shading can catch up
+		float m_ReprojectionDepthTolerance{ 0.05f }; //relative
+		float m_ReprojectionNormalTolerance{ 0.9f }; //minimum cosine
+		ViewState m_PreviousView{};
+		std::vector<ColorRGB> m_HistoryAccumulationBuffer{};
+		std::vector<uint32_t> m_HistorySampleCountBuffer{};
+		std::vector<float> m_HistoryLuminanceSqBuffer{};
+		std::vector<float> m_HistoryDepthBuffer{};
+		std::vector<Vector3> m_HistoryNormalBuffer{};
+		std::vector<uint32_t> m_FreshSampleCountBuffer{}; //samples traced for the current view, m_SampleCountBuffer also counts the history
+		std::atomic<uint32_t> m_NumReprojectedPixels{ 0 };
+
+		//Variable rate tracing, the first pass of a moving view only traces the top left pixel of each rate x rate block
+		//in low importance tiles of the last frame and interpolates the others, refinement passes fill them in
+		bool m_VariableRateEnabled{ false };
+		bool m_IsVariableRatePass{ false };
+		float m_FocusPointX{ 0.5f };
+		float m_FocusPointY{ 0.5f };
+		float m_FoveaRadius{ 0.15f }; //fraction of the diagonal, always full rate
+		float m_PeripheryRadius{ 0.4f }; //beyond this at most half rate
+		float m_RateDepthThreshold{ 0.05f }; //relative depth range of an edge tile
+		float m_RateNormalThreshold{ 0.9f }; //minimum cosine between normals of a flat tile
+		float m_RateContrastThreshold{ 0.2f }; //relative luminance range of a flat tile
+		int m_ShadingRateWidth{ 0 };
+		int m_ShadingRateHeight{ 0 };
+		int m_NumRateTilesX{ 0 };
+		std::vector<uint8_t> m_ShadingRates{}; //1, 2 or 4 per tile
+		std::atomic<uint32_t> m_NumInterpolatedPixels{ 0 };
+
+		//Adaptive sampling, pixels stop receiving samples once their estimate is stable enough
+		bool m_AdaptiveEnabled{ true };
+		uint32_t m_MinAdaptiveSamples{ 8 };
+		float m_AdaptiveThreshold{ 0.02f };
+		std::vector<float> m_LuminanceSqBuffer{};
+		std::atomic<uint32_t> m_NumActivePixels{ 0 };
+
+		//Many lights, above m_MaxExhaustiveLights point lights each hit only shades a few lights picked from the light tree
+		bool m_ManyLightSamplingEnabled{ true };
+		uint32_t m_MaxExhaustiveLights{ 16 };
+		uint32_t m_LightSamplesPerHit{ 4 };
+		//Environment light, importance sampled shadow rays per hit per frame (an R2 pattern through the luminance CDF)
+		uint32_t m_EnvironmentSamples{ 4 };
+		//Light culling, each hit only looks at the lights listed in its cluster of the light grid
+		bool m_LightCullingEnabled{ true };
+
+		//Contribution first shading, lights below this luminance are dropped before their shadow ray
+		float m_MinLightContribution{ 1e-4f };
+		std::atomic<uint32_t> m_NumShadowRaysTraced{ 0 };
+		std::atomic<uint32_t> m_NumShadowRaysSkipped{ 0 };
+
+		struct ShadowRayCounts
+		{
+			uint32_t traced{ 0 };
+			uint32_t skipped{ 0 };
+		};
+
+		//Everything the light loop needs to know about the current hit
+		struct ShadingContext
+		{
+			Scene* pScene;
+			const HitRecord& hit;
+			const Vector3& viewDirection;
+			const std::vector<Material*>& materials;
+
+			uint32_t sampleIndex{ 0 }; //samples already accumulated in the pixel, drives the area light pattern
+			float shiftU{ 0.f };
+			float shiftV{ 0.f };
+			bool useMIS{ false }; //weight area light samples against BRDF sampling (path tracing)
+			ShadowRayCounts shadowRays{};
+		};
+
+		DisplayMode m_CurrentDisplayMode{ DisplayMode::Color };
+
+		//Resolve pass, linear HDR average >> exposure >> tonemap >> sRGB >> SDL surface
+		float m_Exposure{ 1.f };
+		ToneMapper m_CurrentToneMapper{ ToneMapper::ACES };
+		bool m_SRGBEnabled{ true };
+		std::vector<float> m_ResolveBuffer{}; //packed RGB, scratch for the bulk tonemap
+
+		//Denoiser, filters the averaged radiance before the resolve, guided by the first hit of the pixel center sample
+		bool m_DenoiserEnabled{ false };
+		bool m_HasNewSamples{ false }; //since the last denoise, display only changes reuse the filtered buffer
+		Denoiser m_Denoiser{};
+		std::vector<ColorRGB> m_AlbedoBuffer{};
+		std::vector<Vector3> m_NormalBuffer{};
+		std::vector<float> m_DepthBuffer{}; //FLT_MAX where the primary ray missed
+		std::vector<ColorRGB> m_DenoisedBuffer{};
+
+		ImageWriter m_ImageWriter{};
+
+		bool HasFrameChanged(Scene* pScene) const;
+		bool IsPixelConverged(uint32_t pixelIdx) const;
+		void BuildShadingRates();
+		bool IsPixelTraced(int px, int py) const;
+		void InterpolateSkippedPixels();
+		//Adds the previous frame's samples of the surface at hit to the pixel, false on a disocclusion
+		bool ReprojectHistory(uint32_t pixelIdx, const HitRecord& hit, uint32_t& numSamples);
+		ColorRGB ShadeDirect(const std::vector<Light>& lights, uint32_t& lightSeed, ShadingContext& context) const;
+		//primaryHit receives the first surface the path hits (didHit stays false when it sees the background or a light)
+		ColorRGB TracePath(Scene* pScene, const Ray& viewRay, uint32_t pixelIdx, uint32_t numSamples,
+			const std::vector<Light>& lights, const std::vector<Material*>& materials, ShadowRayCounts& shadowRays, HitRecord& primaryHit);
+		ColorRGB SampleLightTree(const std::vector<Light>& lights, uint32_t& seed, ShadingContext& context) const;
+		//Same as SampleLightTree, but only picks from the lights of a light grid cell
+		ColorRGB SampleCellLights(const std::vector<Light>& lights, std::span<const uint32_t> cellLights, uint32_t& seed, ShadingContext& context) const;
+		//weight scales the contribution (sampling weight), it is applied before the culling threshold
+		ColorRGB ShadeLight(const Light& light, float weight, ShadingContext& context) const;
+		ColorRGB ShadeEnvironment(const EnvironmentMap& environment, ShadingContext& context) const;
+		//Average radiance of the pixel (without exposure), the denoised one when the denoiser is enabled
+		ColorRGB GetPixelRadiance(size_t pixelIdx) const;
+		//Radiance of a window pixel, upsampled when the frame was traced at a lower resolution
+		ColorRGB GetDisplayRadiance(int px, int py) const;
+		void SetRenderScale(float scale);
+		//Picks the scale of the next moving frame from the time the last one took
+		void UpdateRenderScale(float frameTime);
+		void DenoiseBuffer();
+		void ResolveBuffer();
+		void PresentBuffer();
 	};
 }
@@ -0,0 +1,105 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#include "Vector3.h"
+#include "MathHelpers.h"
+
+namespace dae
+{
+	namespace Sampling
+	{
+		/**
+		 * \brief R2 low discrepancy sequence (Roberts), every prefix is well stratified over the unit square
+		 * so a running average of its samples converges like a stratified pattern, whatever its length
+		 * \param index sample index
+		 * \param shiftU, shiftV toroidal shift, a different one per pixel decorrelates neighbours
+		 */
+		inline void R2(uint32_t index, float shiftU, float shiftV, float& u, float& v)
+		{
+			constexpr double a1{ 0.7548776662466927 }; //1 / plastic number
+			constexpr double a2{ 0.5698402909980532 }; //1 / plastic number^2
+
+			const double x{ double(shiftU) + a1 * double(index) };
+			const double y{ double(shiftV) + a2 * double(index) };
+			u = std::min(float(x - floor(x)), 0.99999994f);
+			v = std::min(float(y - floor(y)), 0.99999994f);
+		}
+
+		//Tangent and bitangent for a unit normal (Duff et al. 2017, branchless)
+		inline void CreateOrthonormalBasis(const Vector3& normal, Vector3& tangent, Vector3& bitangent)
+		{
+			const float sign{ copysignf(1.f, normal.z) };
+			const float a{ -1.f / (sign + normal.z) };
+			const float b{ normal.x * normal.y * a };
+			tangent = { 1.f + sign * normal.x * normal.x * a, sign * b, -sign * normal.x };
+			bitangent = { b, sign + normal.y * normal.y * a, -normal.y };
+		}
+
+		//Uniform point on the unit disk, concentric mapping keeps the strata of (u, v) compact
+		inline void ConcentricSampleDisk(float u, float v, float& x, float& y)
+		{
+			const float offsetU{ 2.f * u - 1.f };
+			const float offsetV{ 2.f * v - 1.f };
+			if (offsetU == 0.f && offsetV == 0.f)
+			{
+				x = 0.f;
+				y = 0.f;
+				return;
+			}
+
+			float radius{}, theta{};
+			if (std::abs(offsetU) > std::abs(offsetV))
+			{
+				radius = offsetU;
+				theta = PI_DIV_4 * (offsetV / offsetU);
+			}
+			else
+			{
+				radius = offsetV;
+				theta = PI_DIV_2 - PI_DIV_4 * (offsetU / offsetV);
+			}
+			x = radius * cosf(theta);
+			y = radius * sinf(theta);
+		}
+
+		//Cosine weighted direction around normal, pdf = cos / PI
+		inline Vector3 CosineSampleHemisphere(const Vector3& normal, float u, float v)
+		{
+			float x{}, y{};
+			ConcentricSampleDisk(u, v, x, y);
+			const float z{ sqrtf(std::max(0.f, 1.f - x * x - y * y)) };
+
+			Vector3 tangent{}, bitangent{};
+			CreateOrthonormalBasis(normal, tangent, bitangent);
+			return tangent * x + bitangent * y + normal * z;
+		}
+
+		/**
+		 * \brief GGX distributed half vector around normal, pdf = D(h) * dot(normal, h)
+		 * \param alpha GGX alpha (squared roughness, same as BRDF::NormalDistribution_GGX)
+		 */
+		inline Vector3 GGXSampleHalfVector(const Vector3& normal, float alpha, float u, float v)
+		{
+			const float alphaSquared{ alpha * alpha };
+			const float cosTheta{ sqrtf((1.f - u) / (u * (alphaSquared - 1.f) + 1.f)) };
+			const float sinTheta{ sqrtf(std::max(0.f, 1.f - cosTheta * cosTheta)) };
+			const float phi{ PI_2 * v };
+
+			Vector3 tangent{}, bitangent{};
+			CreateOrthonormalBasis(normal, tangent, bitangent);
+			return tangent * (sinTheta * cosf(phi)) + bitangent * (sinTheta * sinf(phi)) + normal * cosTheta;
+		}
+
+		//Power heuristic (beta = 2) weight of a strategy taking numA samples with pdfA against one taking numB with pdfB
+		inline float PowerHeuristic(float numA, float pdfA, float numB, float pdfB)
+		{
+			const float a{ numA * pdfA };
+			const float b{ numB * pdfB };
+			if (a <= 0.f)
+				return 0.f;
+			return (a * a) / (a * a + b * b);
+		}
+	}
+}
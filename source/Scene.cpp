@@ -1,6 +1,8 @@
   #include "Scene.h"
 #include "Utils.h"
 #include "Material.h"
+#include "TextureCache.h"
+#include "EnvironmentMap.h"
 
 namespace dae {
 
@@ -23,6 +25,64 @@ namespace dae {
 			pMaterial = nullptr;
 		}
 		m_Materials.clear();
+
+		for (Texture*& pTexture : m_Textures)
+		{
+			delete pTexture;
+			pTexture = nullptr;
+		}
+		m_Textures.clear();
+
+		//After the textures, they fetch through it
+		delete m_pTextureCache;
+		m_pTextureCache = nullptr;
+
+		delete m_pEnvironment;
+		m_pEnvironment = nullptr;
+	}
+
+	void Scene::Update(dae::Timer* pTimer)
+	{
+		//Nothing is traced between frames, tiles evicted during the last one can be released
+		if (m_pTextureCache)
+			m_pTextureCache->BeginFrame();
+
+		m_Camera.Update(pTimer);
+		UpdateGeometries();
+		UpdateLights();
+	}
+
+	void Scene::UpdateGeometries()
+	{
+		bool hasChanged{ false };
+		for (TriangleMesh& mesh : m_TriangleMeshGeometries)
+		{
+			if (mesh.Update()) //untouched meshes cost nothing
+				hasChanged = true;
+		}
+
+		if (hasChanged)
+			++m_Version;
+	}
+
+	void Scene::UpdateLights()
+	{
+		if (!m_AreLightsDirty)
+			return;
+
+		m_AreaLights.clear();
+		for (uint32_t i{ 0 }; i < m_Lights.size(); ++i)
+		{
+			Light& light{ m_Lights[i] };
+			light.influenceRadius = LightUtils::GetInfluenceRadius(light, m_LightInfluenceThreshold);
+			if (light.IsAreaLight())
+				m_AreaLights.emplace_back(i);
+		}
+
+		m_LightTree.Build(m_Lights);
+		m_LightGrid.Build(m_Lights);
+		m_AreLightsDirty = false;
+		++m_Version;
 	}
 
 	void dae::Scene::GetClosestHit(const Ray& ray, HitRecord& closestHit) const
@@ -76,6 +136,25 @@ namespace dae {
 		return false;
 	}
 
+	bool Scene::HitTestAreaLights(const Ray& ray, uint32_t& lightIndex, float& t) const
+	{
+		bool didHit{ false };
+		float closestT{ ray.max };
+		for (const uint32_t areaLightIndex : m_AreaLights)
+		{
+			float currentT{};
+			if (LightUtils::HitTest_AreaLight(m_Lights[areaLightIndex], ray, currentT).Luminance() > 0.f && currentT < closestT)
+			{
+				closestT = currentT;
+				lightIndex = areaLightIndex;
+				didHit = true;
+			}
+		}
+
+		t = closestT;
+		return didHit;
+	}
+
 #pragma region Scene Helpers
 	Sphere* Scene::AddSphere(const Vector3& origin, float radius, unsigned char materialIndex)
 	{
@@ -85,6 +164,7 @@ namespace dae {
 		s.materialIndex = materialIndex;
 
 		m_SphereGeometries.emplace_back(s);
+		++m_Version;
 		return &m_SphereGeometries.back();
 	}
 
@@ -96,6 +176,7 @@ namespace dae {
 		p.materialIndex = materialIndex;
 
 		m_PlaneGeometries.emplace_back(p);
+		++m_Version;
 		return &m_PlaneGeometries.back();
 	}
 
@@ -106,6 +187,7 @@ namespace dae {
 		m.materialIndex = materialIndex;
 
 		m_TriangleMeshGeometries.emplace_back(m);
+		++m_Version;
 		return &m_TriangleMeshGeometries.back();
 	}
 
@@ -118,6 +200,8 @@ namespace dae {
 		l.type = LightType::Point;
 
 		m_Lights.emplace_back(l);
+		m_AreLightsDirty = true;
+		++m_Version;
 		return &m_Lights.back();
 	}
 
@@ -130,6 +214,59 @@ namespace dae {
 		l.type = LightType::Directional;
 
 		m_Lights.emplace_back(l);
+		m_AreLightsDirty = true;
+		++m_Version;
+		return &m_Lights.back();
+	}
+
+	Light* Scene::AddRectangleLight(const Vector3& origin, const Vector3& halfAxisU, const Vector3& halfAxisV, float radiance, const ColorRGB& color, uint32_t numSamples)
+	{
+		Light l{};
+		l.origin = origin;
+		l.axisU = halfAxisU;
+		l.axisV = halfAxisV;
+		l.direction = Vector3::Cross(halfAxisU, halfAxisV).Normalized();
+		l.intensity = radiance;
+		l.color = color;
+		l.numSamples = numSamples;
+		l.type = LightType::Rectangle;
+
+		m_Lights.emplace_back(l);
+		m_AreLightsDirty = true;
+		++m_Version;
+		return &m_Lights.back();
+	}
+
+	Light* Scene::AddDiskLight(const Vector3& origin, const Vector3& direction, float radius, float radiance, const ColorRGB& color, uint32_t numSamples)
+	{
+		Light l{};
+		l.origin = origin;
+		l.direction = direction.Normalized();
+		l.radius = radius;
+		l.intensity = radiance;
+		l.color = color;
+		l.numSamples = numSamples;
+		l.type = LightType::Disk;
+
+		m_Lights.emplace_back(l);
+		m_AreLightsDirty = true;
+		++m_Version;
+		return &m_Lights.back();
+	}
+
+	Light* Scene::AddSphereLight(const Vector3& origin, float radius, float radiance, const ColorRGB& color, uint32_t numSamples)
+	{
+		Light l{};
+		l.origin = origin;
+		l.radius = radius;
+		l.intensity = radiance;
+		l.color = color;
+		l.numSamples = numSamples;
+		l.type = LightType::Sphere;
+
+		m_Lights.emplace_back(l);
+		m_AreLightsDirty = true;
+		++m_Version;
 		return &m_Lights.back();
 	}
 
@@ -138,6 +275,29 @@ namespace dae {
 		m_Materials.emplace_back(pMaterial);
 		return static_cast<unsigned char>(m_Materials.size() - 1);
 	}
+
+	const Texture* Scene::AddTexture(Texture* pTexture)
+	{
+		m_Textures.emplace_back(pTexture);
+		return pTexture;
+	}
+
+	void Scene::SetEnvironment(EnvironmentMap* pEnvironment)
+	{
+		delete m_pEnvironment;
+		m_pEnvironment = pEnvironment;
+		++m_Version;
+	}
+
+	const Texture* Scene::LoadTexture(const std::string& filename)
+	{
+		const bool isTiled{ filename.size() >= 4 && filename.compare(filename.size() - 4, 4, ".tex") == 0 };
+		if (isTiled && !m_pTextureCache)
+			m_pTextureCache = new TextureCache(m_TextureBudget);
+
+		Texture* pTexture{ isTiled ? Texture::LoadTiled(filename, *m_pTextureCache) : Texture::LoadFromFile(filename) };
+		return pTexture ? AddTexture(pTexture) : nullptr;
+	}
 #pragma endregion
 #pragma endregion
 
@@ -273,9 +433,7 @@ namespace dae {
 			m_pMesh->indices);
 
 		m_pMesh->Scale({ 2.f, 2.f, 2.f });
-
-		m_pMesh->UpdateAABB();
-		m_pMesh->UpdateTransforms();
+		m_pMesh->Update();
 
 		//Light
 		AddPointLight(Vector3{ 0.f, 5.f, 5.f }, 50.f, ColorRGB{ 1.f, 0.61f, 0.45f }); //back light
@@ -285,11 +443,8 @@ namespace dae {
 
 	void Scene_W4_BunnyScene::Update(Timer* pTimer)
 	{
-		Scene::Update(pTimer);
 		m_pMesh->RotateY((cos(pTimer->GetTotal()) + 1.f) / 2.f * PI_2);
-
-		m_pMesh->UpdateAABB();
-		m_pMesh->UpdateTransforms();
+		Scene::Update(pTimer);
 	}
 #pragma endregion
 
@@ -334,20 +489,17 @@ namespace dae {
 		m_Meshes[0] = AddTriangleMesh(TriangleCullMode::BackFaceCulling, matLambert_White);
 		m_Meshes[0]->AppendTriangle(baseTriangle, true);
 		m_Meshes[0]->Translate({ -1.75f, 4.5f, 0.f });
-		m_Meshes[0]->UpdateAABB();
-		m_Meshes[0]->UpdateTransforms();
+		m_Meshes[0]->Update();
 
 		m_Meshes[1] = AddTriangleMesh(TriangleCullMode::FrontFaceCulling, matLambert_White);
 		m_Meshes[1]->AppendTriangle(baseTriangle, true);
 		m_Meshes[1]->Translate({ 0.f, 4.5f, 0.f });
-		m_Meshes[1]->UpdateAABB();
-		m_Meshes[1]->UpdateTransforms();	
+		m_Meshes[1]->Update();	
 
 		m_Meshes[2] = AddTriangleMesh(TriangleCullMode::NoCulling, matLambert_White);
 		m_Meshes[2]->AppendTriangle(baseTriangle, true);
 		m_Meshes[2]->Translate({ 1.75f, 4.5f, 0.f });
-		m_Meshes[2]->UpdateAABB();
-		m_Meshes[2]->UpdateTransforms();
+		m_Meshes[2]->Update();
 
 		//Light
 		AddPointLight(Vector3{ 0.f, 5.f, 5.f }, 50.f, ColorRGB{ 1.f, 0.61f, 0.45f }); //back light
@@ -357,15 +509,149 @@ namespace dae {
 
 	void Scene_W4_ReferenceScene::Update(Timer* pTimer)
 	{
-		Scene::Update(pTimer);
-		
 		const float yawAngle = (cos(pTimer->GetTotal()) + 1.f) / 2.f * PI_2;
 		for (const auto& m : m_Meshes)
-		{
 			m->RotateY(yawAngle);
-			m->UpdateAABB();
-			m->UpdateTransforms();
+
+		Scene::Update(pTimer);
+	}
+#pragma endregion
+
+#pragma region SCENE MANY LIGHTS
+	void Scene_ManyLights::Initialize()
+	{
+		sceneName = "Many Lights Scene";
+		m_Camera.origin = { 0.f, 6.f, -14.f };
+		m_Camera.fovAngle = 45.f;
+		m_Camera.totalPitch = -15.f * TO_RADIANS;
+
+		//Materials
+		const unsigned char matLambert_Gray = AddMaterial(new Material_Lambert({ 0.6f, 0.6f, 0.6f }, 1.f));
+		const unsigned char matCT_GrayMediumPlastic = AddMaterial(new Material_CookTorrence({ 0.75f, 0.75f, 0.75f }, 0.f, 0.6f));
+		const unsigned char matCT_GrayMediumMetal = AddMaterial(new Material_CookTorrence({ 0.972f, 0.960f, 0.915f }, 1.f, 0.4f));
+
+		//Planes
+		AddPlane(Vector3{ 0.f, 0.f, 0.f }, Vector3{ 0.f, 1.f, 0.f }, matLambert_Gray); //bottom
+		AddPlane(Vector3{ 0.f, 0.f, 12.f }, Vector3{ 0.f, 0.f, -1.f }, matLambert_Gray); //back
+
+		//Spheres
+		for (int x{ -2 }; x <= 2; ++x)
+		{
+			for (int z{ 0 }; z < 3; ++z)
+				AddSphere(Vector3{ x * 3.f, 1.f, z * 3.f }, 1.f, (x + z) % 2 == 0 ? matCT_GrayMediumPlastic : matCT_GrayMediumMetal);
 		}
+
+		//Lights, deterministic random positions and colors above the floor
+		m_Lights.reserve(m_NumLights + 1);
+		for (uint32_t i{ 0 }; i < m_NumLights; ++i)
+		{
+			uint32_t seed{ Hash(i) };
+			const Vector3 origin{ (RandomFloat(seed) - 0.5f) * 20.f, 0.3f + RandomFloat(seed) * 4.f, RandomFloat(seed) * 12.f - 2.f };
+			const ColorRGB color{ RandomFloat(seed), RandomFloat(seed), RandomFloat(seed) };
+			AddPointLight(origin, 400.f / float(m_NumLights), color);
+		}
+		AddDirectionalLight(Vector3{ 0.2f, -1.f, 0.4f }, 0.1f, colors::White);
+	}
+#pragma endregion
+
+#pragma region SCENE ENVIRONMENT
+	void Scene_Environment::Initialize()
+	{
+		sceneName = "Environment Scene";
+		m_Camera.origin = { 0.f, 2.f, -9.f };
+		m_Camera.fovAngle = 45.f;
+
+		//Low sun, most of the light comes from a tiny part of the sky
+		SetEnvironment(EnvironmentMap::CreateSky(1024, 512, Vector3{ -0.5f, 0.45f, 0.6f }, ColorRGB{ 2000.f, 1800.f, 1500.f },
+			ColorRGB{ 0.8f, 0.85f, 0.9f }, ColorRGB{ 0.2f, 0.35f, 0.8f }));
+
+		//Materials
+		const unsigned char matLambert_White = AddMaterial(new Material_Lambert(colors::White, 1.f));
+		const unsigned char matLambert_GrayBlue = AddMaterial(new Material_Lambert({ 0.49f, 0.57f, 0.57f }, 1.f));
+		const unsigned char matCT_GrayRoughPlastic = AddMaterial(new Material_CookTorrence({ 0.75f, 0.75f, 0.75f }, 0.f, 1.f));
+		const unsigned char matCT_GoldSmoothMetal = AddMaterial(new Material_CookTorrence({ 1.f, 0.782f, 0.344f }, 1.f, 0.2f));
+
+		//Ground only, the sky must stay visible
+		AddPlane(Vector3{ 0.f, 0.f, 0.f }, Vector3{ 0.f, 1.f, 0.f }, matLambert_GrayBlue);
+
+		//Spheres
+		AddSphere(Vector3{ -2.5f, 1.f, 0.f }, 1.f, matLambert_White);
+		AddSphere(Vector3{ 0.f, 1.f, 1.f }, 1.f, matCT_GrayRoughPlastic);
+		AddSphere(Vector3{ 2.5f, 1.f, 0.f }, 1.f, matCT_GoldSmoothMetal);
+	}
+#pragma endregion
+
+#pragma region SCENE AREA LIGHTS
+	void Scene_AreaLights::Initialize()
+	{
+		sceneName = "Area Lights Scene";
+		m_Camera.origin = { 0.f, 3.f, -9.f };
+		m_Camera.fovAngle = 45.f;
+
+		//Materials
+		const unsigned char matLambert_GrayBlue = AddMaterial(new Material_Lambert({ 0.49f, 0.57f, 0.57f }, 1.f));
+		const unsigned char matLambert_White = AddMaterial(new Material_Lambert(colors::White, 1.f));
+		const unsigned char matCT_GrayMediumPlastic = AddMaterial(new Material_CookTorrence({ 0.75f, 0.75f, 0.75f }, 0.f, 0.6f));
+		const unsigned char matCT_GraySmoothMetal = AddMaterial(new Material_CookTorrence({ 0.972f, 0.960f, 0.915f }, 1.f, 0.1f));
+
+		//Planes
+		AddPlane(Vector3{ 0.f, 0.f, 10.f }, Vector3{ 0.f, 0.f, -1.f }, matLambert_GrayBlue); //back
+		AddPlane(Vector3{ 0.f, 0.f, 0.f }, Vector3{ 0.f, 1.f, 0.f }, matLambert_GrayBlue); //bottom
+		AddPlane(Vector3{ 0.f, 10.f, 0.f }, Vector3{ 0.f, -1.f, 0.f }, matLambert_GrayBlue); //top
+		AddPlane(Vector3{ 5.f, 0.f, 0.f }, Vector3{ -1.f, 0.f, 0.f }, matLambert_GrayBlue); //right
+		AddPlane(Vector3{ -5.f, 0.f, 0.f }, Vector3{ 1.f, 0.f, 0.f }, matLambert_GrayBlue); //left
+
+		//Spheres
+		AddSphere(Vector3{ -1.75f, 1.f, 0.f }, 1.f, matCT_GrayMediumPlastic);
+		AddSphere(Vector3{ 0.f, 1.f, 1.5f }, 1.f, matLambert_White);
+		AddSphere(Vector3{ 1.75f, 1.f, 0.f }, 1.f, matCT_GraySmoothMetal);
+
+		//Lights
+		AddRectangleLight(Vector3{ 0.f, 6.f, 1.f }, Vector3{ 1.5f, 0.f, 0.f }, Vector3{ 0.f, 0.f, 1.f }, 8.f, ColorRGB{ 1.f, 0.8f, 0.45f }, 2); //ceiling panel, facing down
+		AddDiskLight(Vector3{ -4.f, 3.f, -2.f }, Vector3{ 1.f, -0.3f, 0.6f }, 0.75f, 10.f, ColorRGB{ 0.34f, 0.47f, 0.68f });
+		AddSphereLight(Vector3{ 3.f, 3.5f, -2.5f }, 0.4f, 40.f, ColorRGB{ 1.f, 0.61f, 0.45f });
+	}
+#pragma endregion
+
+#pragma region SCENE TEXTURES
+	void Scene_Textures::Initialize()
+	{
+		sceneName = "Textures Scene";
+		m_Camera.origin = { 0.f, 2.f, -8.f };
+		m_Camera.fovAngle = 45.f;
+
+		//Textures, the floor repeats every meter so it is strongly minified towards the horizon
+		const Texture* pChecker{ AddTexture(Texture::CreateChecker(256, 8, { 0.9f, 0.9f, 0.9f }, { 0.1f, 0.1f, 0.1f })) };
+		//Only an explicitly requested floor texture is loaded, the regression references use the checker
+		const Texture* pFloor{ m_FloorTexture.empty() ? nullptr : LoadTexture(m_FloorTexture) };
+		const Texture* pStripes{ AddTexture(Texture::CreateChecker(128, 16, { 0.8f, 0.35f, 0.1f }, { 0.95f, 0.85f, 0.6f })) };
+
+		const unsigned char matTextured_Checker = AddMaterial(new Material_TexturedLambert(pChecker, 1.f));
+		const unsigned char matTextured_Floor = pFloor ? AddMaterial(new Material_TexturedLambert(pFloor, 1.f)) : matTextured_Checker;
+		const unsigned char matTextured_Stripes = AddMaterial(new Material_TexturedLambert(pStripes, 1.f));
+		const unsigned char matLambert_GrayBlue = AddMaterial(new Material_Lambert({ 0.49f, 0.57f, 0.57f }, 1.f));
+
+		//Planes
+		Plane* pFloorPlane{ AddPlane(Vector3{ 0.f, 0.f, 0.f }, Vector3{ 0.f, 1.f, 0.f }, matTextured_Floor) };
+		pFloorPlane->uvScale = 8.f; //one texture (8 x 8 checks) every 8 meters
+		AddPlane(Vector3{ 0.f, 0.f, 60.f }, Vector3{ 0.f, 0.f, -1.f }, matLambert_GrayBlue); //back
+
+		//Spheres
+		AddSphere(Vector3{ -1.75f, 1.f, 0.f }, 1.f, matTextured_Stripes);
+		AddSphere(Vector3{ 1.75f, 1.f, 4.f }, 1.f, matTextured_Checker);
+
+		//Quad mesh with explicit texture coordinates
+		TriangleMesh* pQuad{ AddTriangleMesh(TriangleCullMode::NoCulling, matTextured_Stripes) };
+		pQuad->positions = { { -1.f, 0.f, 0.f }, { 1.f, 0.f, 0.f }, { 1.f, 2.f, 0.f }, { -1.f, 2.f, 0.f } };
+		pQuad->texCoords = { 0.f, 1.f, 2.f, 1.f, 2.f, 0.f, 0.f, 0.f }; //the texture repeats twice horizontally
+		pQuad->indices = { 0, 2, 1, 0, 3, 2 };
+		pQuad->CalculateNormals();
+		pQuad->Translate({ 4.f, 0.f, 2.f });
+		pQuad->Update();
+
+		//Lights
+		AddPointLight(Vector3{ 0.f, 5.f, -5.f }, 50.f, ColorRGB{ 1.f, 0.61f, 0.45f });
+		AddDirectionalLight(Vector3{ 0.3f, -1.f, 0.5f }.Normalized(), 1.5f, ColorRGB{ 0.9f, 0.9f, 1.f });
 	}
 #pragma endregion
 }
@@ -5,12 +5,17 @@
 #include "Math.h"
 #include "DataTypes.h"
 #include "Camera.h"
+#include "LightGrid.h"
+#include "LightTree.h"
 
 namespace dae
 {
 	//Forward Declarations
 	class Timer;
 	class Material;
+	class Texture;
+	class TextureCache;
+	class EnvironmentMap;
 	struct Plane;
 	struct Sphere;
 	struct Light;
@@ -28,19 +33,31 @@ namespace dae
 		Scene& operator=(Scene&&) noexcept = delete;
 
 		virtual void Initialize() = 0;
-		virtual void Update(dae::Timer* pTimer)
-		{
-			m_Camera.Update(pTimer);
-		}
+		//Derived scenes animate their objects first, then call this to refresh only the dirty ones
+		virtual void Update(dae::Timer* pTimer);
 
 		Camera& GetCamera() { return m_Camera; }
+		//Incremented whenever geometry or lights changed, the camera is tracked separately
+		uint32_t GetVersion() const { return m_Version; }
 		void GetClosestHit(const Ray& ray, HitRecord& closestHit) const;
 		bool DoesHit(const Ray& ray) const;
+		//Closest area light surface along the ray (up to ray.max), area lights don't block shadow rays
+		bool HitTestAreaLights(const Ray& ray, uint32_t& lightIndex, float& t) const;
 
 		const std::vector<Plane>& GetPlaneGeometries() const { return m_PlaneGeometries; }
 		const std::vector<Sphere>& GetSphereGeometries() const { return m_SphereGeometries; }
 		const std::vector<Light>& GetLights() const { return m_Lights; }
+		const LightTree& GetLightTree() const { return m_LightTree; }
+		const LightGrid& GetLightGrid() const { return m_LightGrid; }
 		const std::vector<Material*>& GetMaterials() const { return m_Materials; }
+		//nullptr until the first streamed texture is loaded
+		TextureCache* GetTextureCache() const { return m_pTextureCache; }
+		//Memory budget of the streamed texture tiles, call before Initialize
+		void SetTextureBudget(size_t budget) { m_TextureBudget = budget; }
+		//Radiance of rays that leave the scene, nullptr >> black
+		const EnvironmentMap* GetEnvironment() const { return m_pEnvironment; }
+		//The scene takes ownership and replaces the current environment, nullptr removes it
+		void SetEnvironment(EnvironmentMap* pEnvironment);
 
 	protected:
 		std::string	sceneName;
@@ -50,11 +67,25 @@ namespace dae
 		std::vector<TriangleMesh> m_TriangleMeshGeometries{};
 		std::vector<Light> m_Lights{};
 		std::vector<Material*> m_Materials{};
+		std::vector<Texture*> m_Textures{};
+		TextureCache* m_pTextureCache{ nullptr };
+		size_t m_TextureBudget{ size_t(256) << 20 };
+		EnvironmentMap* m_pEnvironment{ nullptr };
+
+		LightTree m_LightTree{};
+		LightGrid m_LightGrid{};
+		std::vector<uint32_t> m_AreaLights{};
+		bool m_AreLightsDirty{ true }; //rebuild the light tree and grid on the next update
+		float m_LightInfluenceThreshold{ 0.01f }; //radiance below which a point light is ignored, 0 disables culling
 
 		//temp
 		std::vector<Triangle> m_Triangles{};
 
 		Camera m_Camera{};
+		uint32_t m_Version{ 0 };
+
+		void UpdateGeometries();
+		void UpdateLights();
 
 		Sphere* AddSphere(const Vector3& origin, float radius, unsigned char materialIndex = 0);
 		Plane* AddPlane(const Vector3& origin, const Vector3& normal, unsigned char materialIndex = 0);
@@ -62,7 +93,15 @@ namespace dae
 
 		Light* AddPointLight(const Vector3& origin, float intensity, const ColorRGB& color);
 		Light* AddDirectionalLight(const Vector3& direction, float intensity, const ColorRGB& color);
+		//Area lights, radiance is the emitted radiance, numSamples the shadow rays per hit per frame
+		Light* AddRectangleLight(const Vector3& origin, const Vector3& halfAxisU, const Vector3& halfAxisV, float radiance, const ColorRGB& color, uint32_t numSamples = 1);
+		Light* AddDiskLight(const Vector3& origin, const Vector3& direction, float radius, float radiance, const ColorRGB& color, uint32_t numSamples = 1);
+		Light* AddSphereLight(const Vector3& origin, float radius, float radiance, const ColorRGB& color, uint32_t numSamples = 1);
 		unsigned char AddMaterial(Material* pMaterial);
+		//The scene takes ownership, returns the texture for the material constructor
+		const Texture* AddTexture(Texture* pTexture);
+		//Tiled files (.tex) are streamed through the texture cache, other images are loaded entirely. nullptr on failure
+		const Texture* LoadTexture(const std::string& filename);
 	};
 
 	//+++++++++++++++++++++++++++++++++++++++++
@@ -147,4 +186,71 @@ namespace dae
 	private:
 		TriangleMesh* m_Meshes[3]{};
 	};
+
+	//Many lights test scene, shading cost should barely depend on the number of lights
+	class Scene_ManyLights final : public Scene
+	{
+	public:
+		explicit Scene_ManyLights(uint32_t numLights = 1024) : m_NumLights(numLights) {}
+		~Scene_ManyLights() override = default;
+
+		Scene_ManyLights(const Scene_ManyLights&) = delete;
+		Scene_ManyLights(Scene_ManyLights&&) noexcept = delete;
+		Scene_ManyLights& operator=(const Scene_ManyLights&) = delete;
+		Scene_ManyLights& operator=(Scene_ManyLights&&) noexcept = delete;
+
+		void Initialize() override;
+
+	private:
+		uint32_t m_NumLights;
+	};
+
+	//Checkered floor to the horizon, textured spheres and a textured quad mesh, exercises the mip selection
+	class Scene_Textures final : public Scene
+	{
+	public:
+		//floorTexture: texture file for the floor (a baked .tex is streamed), empty keeps the procedural checker
+		explicit Scene_Textures(const std::string& floorTexture = {}) : m_FloorTexture(floorTexture) {}
+		~Scene_Textures() override = default;
+
+		Scene_Textures(const Scene_Textures&) = delete;
+		Scene_Textures(Scene_Textures&&) noexcept = delete;
+		Scene_Textures& operator=(const Scene_Textures&) = delete;
+		Scene_Textures& operator=(Scene_Textures&&) noexcept = delete;
+
+		void Initialize() override;
+
+	private:
+		std::string m_FloorTexture;
+	};
+
+	//Outdoor scene lit only by a sky with a small bright sun, exercises environment importance sampling
+	class Scene_Environment final : public Scene
+	{
+	public:
+		Scene_Environment() = default;
+		~Scene_Environment() override = default;
+
+		Scene_Environment(const Scene_Environment&) = delete;
+		Scene_Environment(Scene_Environment&&) noexcept = delete;
+		Scene_Environment& operator=(const Scene_Environment&) = delete;
+		Scene_Environment& operator=(Scene_Environment&&) noexcept = delete;
+
+		void Initialize() override;
+	};
+
+	//Soft shadows from rectangle, disk and sphere lights
+	class Scene_AreaLights final : public Scene
+	{
+	public:
+		Scene_AreaLights() = default;
+		~Scene_AreaLights() override = default;
+
+		Scene_AreaLights(const Scene_AreaLights&) = delete;
+		Scene_AreaLights(Scene_AreaLights&&) noexcept = delete;
+		Scene_AreaLights& operator=(const Scene_AreaLights&) = delete;
+		Scene_AreaLights& operator=(Scene_AreaLights&&) noexcept = delete;
+
+		void Initialize() override;
+	};
 }
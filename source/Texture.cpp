@@ -0,0 +1,268 @@
+#include "Texture.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#include "Image.h"
+#include "TextureCache.h"
+
+using namespace dae;
+
+namespace
+{
+	float SRGBToLinear(float x)
+	{
+		return x <= 0.04045f ? x / 12.92f : powf((x + 0.055f) / 1.055f, 2.4f);
+	}
+
+	//Tiled file: magic, version, tile size, number of levels, (width, height) per level, then the tiles of
+	//every level in order, 3 floats per texel
+	constexpr char TILED_MAGIC[4]{ 'D', 'T', 'E', 'X' };
+	constexpr uint32_t TILED_VERSION{ 1 };
+
+	int Wrap(int value, int size)
+	{
+		const int result{ value % size };
+		return result < 0 ? result + size : result;
+	}
+}
+
+Texture::Texture(int width, int height, const std::vector<ColorRGB>& texels)
+{
+	AddLevel(width, height, texels);
+
+	//Box filtered mip chain down to 1x1, odd sizes clamp the missing texel
+	std::vector<ColorRGB> previous{ texels };
+	while (width > 1 || height > 1)
+	{
+		const int levelWidth{ std::max(width / 2, 1) };
+		const int levelHeight{ std::max(height / 2, 1) };
+		std::vector<ColorRGB> level(size_t(levelWidth) * levelHeight);
+
+		for (int y{ 0 }; y < levelHeight; ++y)
+		{
+			const int y0{ std::min(y * 2, height - 1) };
+			const int y1{ std::min(y * 2 + 1, height - 1) };
+			for (int x{ 0 }; x < levelWidth; ++x)
+			{
+				const int x0{ std::min(x * 2, width - 1) };
+				const int x1{ std::min(x * 2 + 1, width - 1) };
+
+				ColorRGB sum{ previous[size_t(y0) * width + x0] };
+				sum += previous[size_t(y0) * width + x1];
+				sum += previous[size_t(y1) * width + x0];
+				sum += previous[size_t(y1) * width + x1];
+				sum *= 0.25f;
+				level[size_t(y) * levelWidth + x] = sum;
+			}
+		}
+
+		AddLevel(levelWidth, levelHeight, level);
+		previous.swap(level);
+		width = levelWidth;
+		height = levelHeight;
+	}
+}
+
+Texture* Texture::LoadFromFile(const std::string& filename)
+{
+	Image image{};
+	const bool isPFM{ filename.size() >= 4 && filename.compare(filename.size() - 4, 4, ".pfm") == 0 };
+	if (isPFM ? !ImageUtils::LoadPFM(filename, image) : !ImageUtils::LoadPPM(filename, image))
+		return nullptr;
+
+	std::vector<ColorRGB> texels(size_t(image.width) * image.height);
+	for (size_t i{ 0 }; i < texels.size(); ++i)
+	{
+		if (isPFM)
+			texels[i] = { image.radiance[i * 3 + 0], image.radiance[i * 3 + 1], image.radiance[i * 3 + 2] };
+		else
+		{
+			texels[i] = {
+				SRGBToLinear(image.pixels[i * 3 + 0] / 255.f),
+				SRGBToLinear(image.pixels[i * 3 + 1] / 255.f),
+				SRGBToLinear(image.pixels[i * 3 + 2] / 255.f) };
+		}
+	}
+
+	return new Texture(image.width, image.height, texels);
+}
+
+Texture* Texture::CreateChecker(int size, int numChecks, const ColorRGB& colorA, const ColorRGB& colorB)
+{
+	std::vector<ColorRGB> texels(size_t(size) * size);
+	const int checkSize{ std::max(size / std::max(numChecks, 1), 1) };
+	for (int y{ 0 }; y < size; ++y)
+	{
+		for (int x{ 0 }; x < size; ++x)
+			texels[size_t(y) * size + x] = ((x / checkSize + y / checkSize) % 2 == 0) ? colorA : colorB;
+	}
+
+	return new Texture(size, size, texels);
+}
+
+Texture* Texture::LoadTiled(const std::string& filename, TextureCache& cache)
+{
+	std::ifstream file(filename, std::ios::binary);
+	if (!file)
+		return nullptr;
+
+	char magic[4]{};
+	uint32_t header[3]{}; //version, tile size, number of levels
+	file.read(magic, sizeof(magic));
+	file.read(reinterpret_cast<char*>(header), sizeof(header));
+	if (!file || std::memcmp(magic, TILED_MAGIC, sizeof(magic)) != 0 || header[0] != TILED_VERSION
+		|| header[1] != uint32_t(TILE_SIZE) || header[2] == 0 || header[2] > 32)
+		return nullptr;
+
+	Texture* pTexture{ new Texture() };
+	for (uint32_t i{ 0 }; i < header[2]; ++i)
+	{
+		int32_t size[2]{};
+		file.read(reinterpret_cast<char*>(size), sizeof(size));
+		if (!file || size[0] <= 0 || size[1] <= 0)
+		{
+			delete pTexture;
+			return nullptr;
+		}
+		pTexture->AddEmptyLevel(size[0], size[1]);
+	}
+
+	const MipLevel& lastLevel{ pTexture->m_Levels.back() };
+	const uint32_t numTiles{ lastLevel.firstTile + uint32_t(lastLevel.numTilesX * ((lastLevel.height + TILE_SIZE - 1) / TILE_SIZE)) };
+	const uint64_t dataOffset{ uint64_t(file.tellg()) };
+
+	pTexture->m_CacheFileId = cache.AddFile(filename, dataOffset, numTiles);
+	if (pTexture->m_CacheFileId == UINT32_MAX)
+	{
+		delete pTexture;
+		return nullptr;
+	}
+	pTexture->m_pCache = &cache;
+	return pTexture;
+}
+
+bool Texture::WriteTiled(const std::string& filename) const
+{
+	if (IsStreamed())
+		return false;
+
+	std::ofstream file(filename, std::ios::binary);
+	if (!file)
+		return false;
+
+	const uint32_t header[3]{ TILED_VERSION, uint32_t(TILE_SIZE), uint32_t(m_Levels.size()) };
+	file.write(TILED_MAGIC, sizeof(TILED_MAGIC));
+	file.write(reinterpret_cast<const char*>(header), sizeof(header));
+	for (const MipLevel& level : m_Levels)
+	{
+		const int32_t size[2]{ level.width, level.height };
+		file.write(reinterpret_cast<const char*>(size), sizeof(size));
+	}
+
+	//The in memory levels already are tile by tile
+	for (const MipLevel& level : m_Levels)
+		file.write(reinterpret_cast<const char*>(level.texels.data()), std::streamsize(level.texels.size() * sizeof(ColorRGB)));
+
+	return bool(file);
+}
+
+ColorRGB Texture::Sample(float u, float v, float lod) const
+{
+	const float maxLevel{ float(m_Levels.size() - 1) };
+	const float clampedLod{ std::clamp(lod, 0.f, maxLevel) };
+	const int level0{ int(clampedLod) };
+	const float blend{ clampedLod - float(level0) };
+
+	const ColorRGB sample0{ SampleBilinear(m_Levels[level0], u, v) };
+	if (blend <= 0.f)
+		return sample0;
+
+	const ColorRGB sample1{ SampleBilinear(m_Levels[level0 + 1], u, v) };
+	return sample0 * (1.f - blend) + sample1 * blend;
+}
+
+float Texture::GetLod(float footprint, float uvDensity) const
+{
+	//Texels covered by the footprint along the larger side of the texture, 1 texel per pixel >> level 0
+	const float numTexels{ footprint * uvDensity * float(std::max(GetWidth(), GetHeight())) };
+	return numTexels > 1.f ? log2f(numTexels) : 0.f;
+}
+
+size_t Texture::GetMemorySize() const
+{
+	size_t size{ 0 };
+	for (const MipLevel& level : m_Levels)
+		size += level.texels.size() * sizeof(ColorRGB);
+	return size;
+}
+
+size_t Texture::GetTiledIndex(const MipLevel& level, int x, int y)
+{
+	const int tileX{ x / TILE_SIZE };
+	const int tileY{ y / TILE_SIZE };
+	const size_t tileStart{ (size_t(tileY) * level.numTilesX + tileX) * TILE_SIZE * TILE_SIZE };
+	return tileStart + size_t(y % TILE_SIZE) * TILE_SIZE + x % TILE_SIZE;
+}
+
+void Texture::AddLevel(int width, int height, const std::vector<ColorRGB>& texels)
+{
+	//Partial tiles at the right and bottom edge are padded
+	MipLevel& level{ AddEmptyLevel(width, height) };
+	const int numTilesY{ (height + TILE_SIZE - 1) / TILE_SIZE };
+	level.texels.resize(size_t(level.numTilesX) * numTilesY * TILE_SIZE * TILE_SIZE);
+
+	for (int y{ 0 }; y < height; ++y)
+	{
+		for (int x{ 0 }; x < width; ++x)
+			level.texels[GetTiledIndex(level, x, y)] = texels[size_t(y) * width + x];
+	}
+}
+
+Texture::MipLevel& Texture::AddEmptyLevel(int width, int height)
+{
+	MipLevel level{};
+	level.width = width;
+	level.height = height;
+	level.numTilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+	if (!m_Levels.empty())
+	{
+		const MipLevel& previous{ m_Levels.back() };
+		level.firstTile = previous.firstTile + uint32_t(previous.numTilesX * ((previous.height + TILE_SIZE - 1) / TILE_SIZE));
+	}
+
+	return m_Levels.emplace_back(std::move(level));
+}
+
+ColorRGB Texture::Fetch(const MipLevel& level, int x, int y) const
+{
+	const size_t tiledIdx{ GetTiledIndex(level, Wrap(x, level.width), Wrap(y, level.height)) };
+	if (m_pCache)
+	{
+		constexpr size_t tileTexels{ size_t(TILE_SIZE) * TILE_SIZE };
+		return m_pCache->Fetch(m_CacheFileId, level.firstTile + uint32_t(tiledIdx / tileTexels), uint32_t(tiledIdx % tileTexels));
+	}
+	return level.texels[tiledIdx];
+}
+
+ColorRGB Texture::SampleBilinear(const MipLevel& level, float u, float v) const
+{
+	//Texel centers sit at half integers, wrapping first keeps far away plane coordinates in int range
+	const float x{ (u - floorf(u)) * float(level.width) - 0.5f };
+	const float y{ (v - floorf(v)) * float(level.height) - 0.5f };
+	const float floorX{ floorf(x) };
+	const float floorY{ floorf(y) };
+	const int x0{ int(floorX) };
+	const int y0{ int(floorY) };
+	const float fx{ x - floorX };
+	const float fy{ y - floorY };
+
+	const ColorRGB topLeft{ Fetch(level, x0, y0) };
+	const ColorRGB topRight{ Fetch(level, x0 + 1, y0) };
+	const ColorRGB bottomLeft{ Fetch(level, x0, y0 + 1) };
+	const ColorRGB bottomRight{ Fetch(level, x0 + 1, y0 + 1) };
+	const ColorRGB top{ topLeft * (1.f - fx) + topRight * fx };
+	const ColorRGB bottom{ bottomLeft * (1.f - fx) + bottomRight * fx };
+	return top * (1.f - fy) + bottom * fy;
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Math.h"
+
+namespace dae
+{
+	class TextureCache;
+
+	//Mip mapped RGB texture. Every level is stored in TILE_SIZE x TILE_SIZE tiles, so the texels of a bilinear
+	//footprint share one or two cache lines instead of spanning rows of the full image.
+	//Streamed textures keep only their level sizes, the tiles are fetched through a TextureCache.
+	class Texture final
+	{
+	public:
+		static constexpr int TILE_SIZE{ 8 };
+
+		//texels: linear RGB, rows from top to bottom
+		Texture(int width, int height, const std::vector<ColorRGB>& texels);
+		~Texture() = default;
+
+		Texture(const Texture&) = delete;
+		Texture(Texture&&) noexcept = delete;
+		Texture& operator=(const Texture&) = delete;
+		Texture& operator=(Texture&&) noexcept = delete;
+
+		//PFM is read as linear, PPM as sRGB, nullptr if the file could not be read
+		static Texture* LoadFromFile(const std::string& filename);
+		static Texture* CreateChecker(int size, int numChecks, const ColorRGB& colorA, const ColorRGB& colorB);
+
+		/**
+		 * \brief Opens a tiled texture file (see WriteTiled), only the header is read
+		 * \param cache loads the tiles on demand, must outlive the texture
+		 * \return nullptr if the file is not a valid tiled texture
+		 */
+		static Texture* LoadTiled(const std::string& filename, TextureCache& cache);
+		//Writes every mip level tile by tile, the layout a streamed texture reads back. Fails for streamed textures
+		bool WriteTiled(const std::string& filename) const;
+
+		/**
+		 * \brief Trilinear lookup, texture coordinates wrap
+		 * \param lod mip level, fractional values blend two levels (see GetLod)
+		 */
+		ColorRGB Sample(float u, float v, float lod) const;
+
+		/**
+		 * \brief Mip level that matches a footprint
+		 * \param footprint world space width of the pixel footprint on the surface
+		 * \param uvDensity texture coordinate units per world unit at the surface
+		 */
+		float GetLod(float footprint, float uvDensity) const;
+
+		int GetWidth() const { return m_Levels[0].width; }
+		int GetHeight() const { return m_Levels[0].height; }
+		int GetNumLevels() const { return int(m_Levels.size()); }
+		bool IsStreamed() const { return m_pCache != nullptr; }
+		//Resident texels, 0 for streamed textures (their tiles are accounted for by the cache)
+		size_t GetMemorySize() const;
+
+	private:
+		struct MipLevel
+		{
+			int width{};
+			int height{};
+			int numTilesX{};
+			uint32_t firstTile{}; //tiles of all previous levels
+			std::vector<ColorRGB> texels{}; //tile by tile, row major inside a tile
+		};
+
+		std::vector<MipLevel> m_Levels{};
+		TextureCache* m_pCache{ nullptr };
+		uint32_t m_CacheFileId{ 0 };
+
+		Texture() = default;
+		static size_t GetTiledIndex(const MipLevel& level, int x, int y);
+		void AddLevel(int width, int height, const std::vector<ColorRGB>& texels);
+		MipLevel& AddEmptyLevel(int width, int height);
+		ColorRGB Fetch(const MipLevel& level, int x, int y) const;
+		ColorRGB SampleBilinear(const MipLevel& level, float u, float v) const;
+	};
+}
@@ -0,0 +1,189 @@
+#include "TextureCache.h"
+
+#include <algorithm>
+
+using namespace dae;
+
+namespace
+{
+	std::atomic<uint32_t> g_NumThreads{ 0 };
+	thread_local const uint32_t t_ThreadIdx{ g_NumThreads.fetch_add(1, std::memory_order_relaxed) };
+
+	//Evicting a batch down to this fraction of the budget keeps a streaming working set from evicting on every miss
+	constexpr float EVICTION_TARGET{ 0.9f };
+}
+
+TextureCache::TextureCache(size_t budget) :
+	m_Budget(std::max(budget, TILE_SIZE_BYTES))
+{
+}
+
+TextureCache::~TextureCache()
+{
+	for (const std::unique_ptr<File>& pFile : m_Files)
+	{
+		for (uint32_t i{ 0 }; i < pFile->numTiles; ++i)
+			delete pFile->tiles[i].load(std::memory_order_relaxed);
+	}
+
+	for (Tile*& pTile : m_EvictedTiles)
+	{
+		delete pTile;
+		pTile = nullptr;
+	}
+	m_EvictedTiles.clear();
+}
+
+uint32_t TextureCache::AddFile(const std::string& filename, uint64_t dataOffset, uint32_t numTiles)
+{
+	std::unique_ptr<File> pFile{ std::make_unique<File>() };
+	pFile->stream.open(filename, std::ios::binary);
+	if (!pFile->stream)
+		return UINT32_MAX;
+
+	pFile->dataOffset = dataOffset;
+	pFile->numTiles = numTiles;
+	pFile->tiles = std::make_unique<std::atomic<Tile*>[]>(numTiles);
+	pFile->lastUsed = std::make_unique<std::atomic<uint32_t>[]>(numTiles);
+	for (uint32_t i{ 0 }; i < numTiles; ++i)
+	{
+		pFile->tiles[i].store(nullptr, std::memory_order_relaxed);
+		pFile->lastUsed[i].store(0, std::memory_order_relaxed);
+	}
+
+	m_Files.emplace_back(std::move(pFile));
+	return uint32_t(m_Files.size() - 1);
+}
+
+ColorRGB TextureCache::Fetch(uint32_t fileId, uint32_t tileIdx, uint32_t texelIdx)
+{
+	File& file{ *m_Files[fileId] };
+	ThreadStatistics& statistics{ GetThreadStatistics() };
+
+	const Tile* pTile{ file.tiles[tileIdx].load(std::memory_order_acquire) };
+	if (pTile)
+	{
+		statistics.numHits.store(statistics.numHits.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+		//Only the first lookup of a frame writes, the others keep the cache line shared
+		const uint32_t frame{ m_Frame.load(std::memory_order_relaxed) };
+		if (file.lastUsed[tileIdx].load(std::memory_order_relaxed) != frame)
+			file.lastUsed[tileIdx].store(frame, std::memory_order_relaxed);
+	}
+	else
+	{
+		statistics.numMisses.store(statistics.numMisses.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		pTile = LoadTile(file, fileId, tileIdx);
+	}
+
+	return pTile->texels[texelIdx];
+}
+
+void TextureCache::BeginFrame()
+{
+	std::lock_guard<std::mutex> lock{ m_Mutex };
+	for (Tile*& pTile : m_EvictedTiles)
+	{
+		delete pTile;
+		pTile = nullptr;
+	}
+	m_EvictedTiles.clear();
+
+	m_Frame.fetch_add(1, std::memory_order_relaxed);
+}
+
+TextureCacheStatistics TextureCache::GetStatistics()
+{
+	TextureCacheStatistics result{};
+	for (const ThreadStatistics& statistics : m_ThreadStatistics)
+	{
+		result.numHits += statistics.numHits.load(std::memory_order_relaxed);
+		result.numMisses += statistics.numMisses.load(std::memory_order_relaxed);
+	}
+
+	std::lock_guard<std::mutex> lock{ m_Mutex };
+	result.numLoads = m_NumLoads;
+	result.numEvictions = m_NumEvictions;
+	result.residentSize = m_ResidentSize;
+	result.peakResidentSize = m_PeakResidentSize;
+	return result;
+}
+
+void TextureCache::ResetStatistics()
+{
+	for (ThreadStatistics& statistics : m_ThreadStatistics)
+	{
+		statistics.numHits.store(0, std::memory_order_relaxed);
+		statistics.numMisses.store(0, std::memory_order_relaxed);
+	}
+
+	std::lock_guard<std::mutex> lock{ m_Mutex };
+	m_NumLoads = 0;
+	m_NumEvictions = 0;
+	m_PeakResidentSize = m_ResidentSize;
+}
+
+TextureCache::ThreadStatistics& TextureCache::GetThreadStatistics()
+{
+	return m_ThreadStatistics[t_ThreadIdx % MAX_THREADS];
+}
+
+const TextureCache::Tile* TextureCache::LoadTile(File& file, uint32_t fileId, uint32_t tileIdx)
+{
+	std::lock_guard<std::mutex> lock{ m_Mutex };
+
+	//Another thread may have loaded it while this one waited
+	if (const Tile* pResident{ file.tiles[tileIdx].load(std::memory_order_acquire) })
+		return pResident;
+
+	if (m_ResidentSize + TILE_SIZE_BYTES > m_Budget)
+		EvictTiles();
+
+	Tile* pTile{ new Tile() };
+	file.stream.clear();
+	file.stream.seekg(std::streamoff(file.dataOffset + uint64_t(tileIdx) * TILE_SIZE_BYTES));
+	file.stream.read(reinterpret_cast<char*>(pTile->texels), std::streamsize(TILE_SIZE_BYTES));
+	//A truncated file leaves black texels, the lookup still succeeds
+
+	file.lastUsed[tileIdx].store(m_Frame.load(std::memory_order_relaxed), std::memory_order_relaxed);
+	file.tiles[tileIdx].store(pTile, std::memory_order_release);
+	m_ResidentTiles.emplace_back(fileId, tileIdx);
+	m_ResidentSize += TILE_SIZE_BYTES;
+	m_PeakResidentSize = std::max(m_PeakResidentSize, m_ResidentSize);
+	++m_NumLoads;
+	return pTile;
+}
+
+void TextureCache::EvictTiles()
+{
+	//Oldest first. Lookups keep stamping while this runs, sorting a snapshot keeps the order consistent
+	std::vector<std::pair<uint32_t, size_t>> ages(m_ResidentTiles.size());
+	for (size_t i{ 0 }; i < m_ResidentTiles.size(); ++i)
+	{
+		const std::pair<uint32_t, uint32_t>& resident{ m_ResidentTiles[i] };
+		ages[i] = { m_Files[resident.first]->lastUsed[resident.second].load(std::memory_order_relaxed), i };
+	}
+	std::sort(ages.begin(), ages.end());
+
+	const size_t targetSize{ size_t(float(m_Budget) * EVICTION_TARGET) };
+	std::vector<bool> isEvicted(m_ResidentTiles.size(), false);
+	for (size_t i{ 0 }; i < ages.size() && m_ResidentSize + TILE_SIZE_BYTES > targetSize; ++i)
+	{
+		const size_t residentIdx{ ages[i].second };
+		const std::pair<uint32_t, uint32_t>& resident{ m_ResidentTiles[residentIdx] };
+
+		//Lookups that already hold the pointer keep using it until BeginFrame releases it
+		m_EvictedTiles.emplace_back(m_Files[resident.first]->tiles[resident.second].exchange(nullptr, std::memory_order_acq_rel));
+		isEvicted[residentIdx] = true;
+		m_ResidentSize -= TILE_SIZE_BYTES;
+		++m_NumEvictions;
+	}
+
+	size_t numKept{ 0 };
+	for (size_t i{ 0 }; i < m_ResidentTiles.size(); ++i)
+	{
+		if (!isEvicted[i])
+			m_ResidentTiles[numKept++] = m_ResidentTiles[i];
+	}
+	m_ResidentTiles.resize(numKept);
+}
@@ -0,0 +1,102 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "Math.h"
+#include "Texture.h"
+
+namespace dae
+{
+	struct TextureCacheStatistics
+	{
+		uint64_t numHits{ 0 };
+		uint64_t numMisses{ 0 };
+		uint64_t numLoads{ 0 }; //tiles read from disk, two threads missing the same tile load it once
+		uint64_t numEvictions{ 0 };
+		size_t residentSize{ 0 }; //bytes
+		size_t peakResidentSize{ 0 };
+	};
+
+	//Tiles of streamed textures, loaded on the first lookup and evicted least recently used first once the
+	//resident tiles exceed the budget. Lookups of resident tiles are a single atomic load, only misses take the lock.
+	//Evicted tiles are released in BeginFrame, when no lookup can still hold them, so the budget may be exceeded
+	//within a frame whose working set does not fit.
+	class TextureCache final
+	{
+	public:
+		static constexpr int TILE_TEXELS{ Texture::TILE_SIZE * Texture::TILE_SIZE };
+		static constexpr size_t TILE_SIZE_BYTES{ TILE_TEXELS * sizeof(ColorRGB) };
+
+		explicit TextureCache(size_t budget);
+		~TextureCache();
+
+		TextureCache(const TextureCache&) = delete;
+		TextureCache(TextureCache&&) noexcept = delete;
+		TextureCache& operator=(const TextureCache&) = delete;
+		TextureCache& operator=(TextureCache&&) noexcept = delete;
+
+		/**
+		 * \brief Registers a file of numTiles consecutive tiles, not thread safe with Fetch (call before rendering)
+		 * \param dataOffset byte offset of the first tile in the file
+		 * \return id passed to Fetch, UINT32_MAX if the file could not be opened
+		 */
+		uint32_t AddFile(const std::string& filename, uint64_t dataOffset, uint32_t numTiles);
+
+		//Texel texelIdx (row major inside the tile) of tile tileIdx, safe to call from any number of threads
+		ColorRGB Fetch(uint32_t fileId, uint32_t tileIdx, uint32_t texelIdx);
+
+		//Call once per frame while nothing is being traced, frees the evicted tiles and advances the LRU clock
+		void BeginFrame();
+
+		size_t GetBudget() const { return m_Budget; }
+		TextureCacheStatistics GetStatistics();
+		void ResetStatistics();
+
+	private:
+		struct Tile
+		{
+			ColorRGB texels[TILE_TEXELS]{};
+		};
+
+		struct File
+		{
+			std::ifstream stream{};
+			uint64_t dataOffset{};
+			uint32_t numTiles{};
+			std::unique_ptr<std::atomic<Tile*>[]> tiles{};
+			std::unique_ptr<std::atomic<uint32_t>[]> lastUsed{}; //frame of the last lookup
+		};
+
+		//One padded slot per thread, plain loads and stores so the hit path never locks the bus.
+		//Threads beyond MAX_THREADS share slots and may lose a count.
+		static constexpr uint32_t MAX_THREADS{ 64 };
+		struct alignas(64) ThreadStatistics
+		{
+			std::atomic<uint64_t> numHits{ 0 };
+			std::atomic<uint64_t> numMisses{ 0 };
+		};
+
+		const size_t m_Budget;
+		std::vector<std::unique_ptr<File>> m_Files{};
+		ThreadStatistics m_ThreadStatistics[MAX_THREADS]{};
+		std::atomic<uint32_t> m_Frame{ 0 };
+
+		//Guarded by m_Mutex
+		std::mutex m_Mutex{};
+		std::vector<std::pair<uint32_t, uint32_t>> m_ResidentTiles{}; //(fileId, tileIdx)
+		std::vector<Tile*> m_EvictedTiles{};
+		size_t m_ResidentSize{ 0 };
+		size_t m_PeakResidentSize{ 0 };
+		uint64_t m_NumLoads{ 0 };
+		uint64_t m_NumEvictions{ 0 };
+
+		ThreadStatistics& GetThreadStatistics();
+		const Tile* LoadTile(File& file, uint32_t fileId, uint32_t tileIdx);
+		void EvictTiles();
+	};
+}
@@ -64,6 +64,17 @@ void Timer::StartBenchmark(int numFrames)
 	std::cout<< "**BENCHMARK STARTED**\n";
 }
 
+void Timer::SetFixedTimeStep(float timeStep)
+{
+	m_FixedTimeStep = std::max(timeStep, 0.f);
+	if (m_FixedTimeStep > 0.f)
+	{
+		//Simulation restarts at 0 so every run sees the same sequence of times
+		m_TotalTime = 0.f;
+		m_ElapsedTime = m_FixedTimeStep;
+	}
+}
+
 void Timer::Update()
 {
 	if (m_IsStopped)
@@ -77,21 +88,31 @@ void Timer::Update()
 	const uint64_t currentTime = SDL_GetPerformanceCounter();
 	m_CurrentTime = currentTime;
 
-	m_ElapsedTime = (float)((m_CurrentTime - m_PreviousTime) * m_SecondsPerCount);
+	float realElapsedTime = (float)((m_CurrentTime - m_PreviousTime) * m_SecondsPerCount);
 	m_PreviousTime = m_CurrentTime;
 
-	if (m_ElapsedTime < 0.0f)
-		m_ElapsedTime = 0.0f;
+	if (realElapsedTime < 0.0f)
+		realElapsedTime = 0.0f;
 
-	if (m_ForceElapsedUpperBound && m_ElapsedTime > m_ElapsedUpperBound)
+	if (m_FixedTimeStep > 0.0f)
 	{
-		m_ElapsedTime = m_ElapsedUpperBound;
+		//Simulation time only depends on the number of updates
+		m_ElapsedTime = m_FixedTimeStep;
+		m_TotalTime += m_FixedTimeStep;
 	}
+	else
+	{
+		m_ElapsedTime = realElapsedTime;
+		if (m_ForceElapsedUpperBound && m_ElapsedTime > m_ElapsedUpperBound)
+		{
+			m_ElapsedTime = m_ElapsedUpperBound;
+		}
 
-	m_TotalTime = (float)(((m_CurrentTime - m_PausedTime) - m_BaseTime) * m_SecondsPerCount);
+		m_TotalTime = (float)(((m_CurrentTime - m_PausedTime) - m_BaseTime) * m_SecondsPerCount);
+	}
 
-	//FPS LOGIC
-	m_FPSTimer += m_ElapsedTime;
+	//FPS LOGIC (always wall clock)
+	m_FPSTimer += realElapsedTime;
 	++m_FPSCount;
 	if (m_FPSTimer >= 1.0f)
 	{
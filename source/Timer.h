@@ -18,6 +18,9 @@ namespace dae
 		Timer& operator=(Timer&&) noexcept = delete;
 
 		void StartBenchmark(int numFrames = 10);
+		//Advance the simulation clock by a fixed amount per Update instead of wall clock time (0 = wall clock)
+		void SetFixedTimeStep(float timeStep);
+		bool IsFixedTimeStep() const { return m_FixedTimeStep > 0.f; }
 
 		void Reset();
 		void Start();
@@ -46,6 +49,7 @@ namespace dae
 		float m_SecondsPerCount{ 0.0f };
 		float m_ElapsedUpperBound{ 0.03f };
 		float m_FPSTimer{ 0.0f };
+		float m_FixedTimeStep{ 0.0f };
 
 		bool m_IsStopped{ true };
 		bool m_ForceElapsedUpperBound{ false };
@@ -0,0 +1,124 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define TONEMAPPING_SSE
+#endif
+
+namespace dae
+{
+	enum class ToneMapper
+	{
+		MaxToOne, //scales down colors brighter than 1 (previous behaviour)
+		Reinhard,
+		ACES
+	};
+
+	namespace ToneMapping
+	{
+		/**
+		 * \brief Reinhard operator, x / (1 + x)
+		 * \param x linear radiance (after exposure)
+		 * \return display value in [0, 1)
+		 */
+		inline float Reinhard(float x)
+		{
+			return x / (1.f + x);
+		}
+
+		/**
+		 * \brief ACES filmic curve (Narkowicz fit)
+		 * \param x linear radiance (after exposure)
+		 * \return display value in [0, 1]
+		 */
+		inline float ACES(float x)
+		{
+			const float result{ (x * (2.51f * x + 0.03f)) / (x * (2.43f * x + 0.59f) + 0.14f) };
+			return std::min(std::max(result, 0.f), 1.f);
+		}
+
+		inline float LinearToSRGB(float x)
+		{
+			if (x <= 0.0031308f)
+				return 12.92f * x;
+			return 1.055f * powf(x, 1.f / 2.4f) - 0.055f;
+		}
+
+		//Bulk versions, tonemap a packed array of channels (RGBRGB...) in place
+		inline void Reinhard(float* pValues, size_t count)
+		{
+			size_t i{ 0 };
+#if defined(TONEMAPPING_SSE)
+			const __m128 one{ _mm_set1_ps(1.f) };
+			for (; i + 4 <= count; i += 4)
+			{
+				const __m128 x{ _mm_loadu_ps(pValues + i) };
+				_mm_storeu_ps(pValues + i, _mm_div_ps(x, _mm_add_ps(one, x)));
+			}
+#endif
+			for (; i < count; ++i)
+				pValues[i] = Reinhard(pValues[i]);
+		}
+
+		inline void ACES(float* pValues, size_t count)
+		{
+			size_t i{ 0 };
+#if defined(TONEMAPPING_SSE)
+			const __m128 a{ _mm_set1_ps(2.51f) };
+			const __m128 b{ _mm_set1_ps(0.03f) };
+			const __m128 c{ _mm_set1_ps(2.43f) };
+			const __m128 d{ _mm_set1_ps(0.59f) };
+			const __m128 e{ _mm_set1_ps(0.14f) };
+			const __m128 zero{ _mm_setzero_ps() };
+			const __m128 one{ _mm_set1_ps(1.f) };
+			for (; i + 4 <= count; i += 4)
+			{
+				const __m128 x{ _mm_loadu_ps(pValues + i) };
+				const __m128 numerator{ _mm_mul_ps(x, _mm_add_ps(_mm_mul_ps(a, x), b)) };
+				const __m128 denominator{ _mm_add_ps(_mm_mul_ps(x, _mm_add_ps(_mm_mul_ps(c, x), d)), e) };
+				const __m128 result{ _mm_div_ps(numerator, denominator) };
+				_mm_storeu_ps(pValues + i, _mm_min_ps(_mm_max_ps(result, zero), one));
+			}
+#endif
+			for (; i < count; ++i)
+				pValues[i] = ACES(pValues[i]);
+		}
+
+		//Scales every RGB triplet whose max channel is above 1 back to 1
+		inline void MaxToOne(float* pValues, size_t count)
+		{
+			for (size_t i{ 0 }; i + 3 <= count; i += 3)
+			{
+				const float maxValue{ std::max(pValues[i], std::max(pValues[i + 1], pValues[i + 2])) };
+				if (maxValue > 1.f)
+				{
+					const float invMax{ 1.f / maxValue };
+					pValues[i] *= invMax;
+					pValues[i + 1] *= invMax;
+					pValues[i + 2] *= invMax;
+				}
+			}
+		}
+
+		//Linear [0, 1] >> 8 bit sRGB, indexed with value * (size - 1), avoids a powf per channel
+		constexpr size_t SRGB_TABLE_SIZE{ 4096 };
+		inline const std::array<uint8_t, SRGB_TABLE_SIZE>& GetSRGBTable()
+		{
+			static const std::array<uint8_t, SRGB_TABLE_SIZE> table{ []()
+				{
+					std::array<uint8_t, SRGB_TABLE_SIZE> result{};
+					for (size_t i{ 0 }; i < SRGB_TABLE_SIZE; ++i)
+					{
+						const float linear{ float(i) / float(SRGB_TABLE_SIZE - 1) };
+						result[i] = static_cast<uint8_t>(LinearToSRGB(linear) * 255.f + 0.5f);
+					}
+					return result;
+				}() };
+			return table;
+		}
+	}
+}
@@ -0,0 +1,175 @@
+#include "Transform.h"
+
+#include <cassert>
+
+#include "Matrix.h"
+#include "Vector4.h"
+
+namespace dae {
+#pragma region AffineMatrix
+	AffineMatrix::AffineMatrix(const Vector3& xAxis, const Vector3& yAxis, const Vector3& zAxis, const Vector3& t) :
+		axisX(xAxis), axisY(yAxis), axisZ(zAxis), translation(t)
+	{
+	}
+
+	AffineMatrix::AffineMatrix(const Matrix& m) :
+		axisX(m.GetAxisX()), axisY(m.GetAxisY()), axisZ(m.GetAxisZ()), translation(m.GetTranslation())
+	{
+	}
+
+	Vector3 AffineMatrix::TransformVector(const Vector3& v) const
+	{
+		return Vector3{
+			axisX.x * v.x + axisY.x * v.y + axisZ.x * v.z,
+			axisX.y * v.x + axisY.y * v.y + axisZ.y * v.z,
+			axisX.z * v.x + axisY.z * v.y + axisZ.z * v.z
+		};
+	}
+
+	Vector3 AffineMatrix::TransformPoint(const Vector3& p) const
+	{
+		return TransformPoint(p.x, p.y, p.z);
+	}
+
+	Vector3 AffineMatrix::TransformPoint(float x, float y, float z) const
+	{
+		return Vector3{
+			axisX.x * x + axisY.x * y + axisZ.x * z + translation.x,
+			axisX.y * x + axisY.y * y + axisZ.y * z + translation.y,
+			axisX.z * x + axisY.z * y + axisZ.z * z + translation.z
+		};
+	}
+
+	float AffineMatrix::Determinant() const
+	{
+		return Vector3::Dot(axisX, Vector3::Cross(axisY, axisZ));
+	}
+
+	AffineMatrix AffineMatrix::Inverse() const
+	{
+		//The rows of the inverse-transpose are the cofactor rows / determinant,
+		//so the inverse is that matrix transposed
+		const AffineMatrix cofactors{ InverseTranspose() };
+
+		AffineMatrix result{
+			{ cofactors.axisX.x, cofactors.axisY.x, cofactors.axisZ.x },
+			{ cofactors.axisX.y, cofactors.axisY.y, cofactors.axisZ.y },
+			{ cofactors.axisX.z, cofactors.axisY.z, cofactors.axisZ.z },
+			{}
+		};
+		result.translation = -result.TransformVector(translation);
+
+		return result;
+	}
+
+	AffineMatrix AffineMatrix::InverseTranspose() const
+	{
+		const float determinant{ Determinant() };
+		assert(determinant != 0.f && "AffineMatrix is not invertible");
+
+		const float invDeterminant{ 1.f / determinant };
+		return AffineMatrix{
+			Vector3::Cross(axisY, axisZ) * invDeterminant,
+			Vector3::Cross(axisZ, axisX) * invDeterminant,
+			Vector3::Cross(axisX, axisY) * invDeterminant,
+			{}
+		};
+	}
+
+	Matrix AffineMatrix::ToMatrix() const
+	{
+		return Matrix{ axisX, axisY, axisZ, translation };
+	}
+
+	AffineMatrix AffineMatrix::operator*(const AffineMatrix& m) const
+	{
+		return AffineMatrix{
+			m.TransformVector(axisX),
+			m.TransformVector(axisY),
+			m.TransformVector(axisZ),
+			m.TransformPoint(translation)
+		};
+	}
+#pragma endregion
+
+#pragma region Transform
+	static bool AreIdentical(const Vector3& v1, const Vector3& v2)
+	{
+		return v1.x == v2.x && v1.y == v2.y && v1.z == v2.z;
+	}
+
+	void Transform::SetTranslation(const Vector3& translation)
+	{
+		if (AreIdentical(translation, m_Translation))
+			return;
+
+		m_Translation = translation;
+		MarkDirty();
+	}
+
+	void Transform::SetRotation(const Vector3& pitchYawRoll)
+	{
+		if (AreIdentical(pitchYawRoll, m_Rotation))
+			return;
+
+		m_Rotation = pitchYawRoll;
+		MarkDirty();
+	}
+
+	void Transform::SetRotationY(float yaw)
+	{
+		SetRotation({ 0.f, yaw, 0.f });
+	}
+
+	void Transform::SetScale(const Vector3& scale)
+	{
+		if (AreIdentical(scale, m_Scale))
+			return;
+
+		m_Scale = scale;
+		MarkDirty();
+	}
+
+	void Transform::MarkDirty()
+	{
+		m_DirtyFlags = Dirty_All;
+		++m_Version;
+	}
+
+	const AffineMatrix& Transform::GetMatrix()
+	{
+		if (m_DirtyFlags & Dirty_Matrix)
+		{
+			//Scale * Rotation * Translation, without the full 4x4 multiplications
+			const AffineMatrix rotation{ Matrix::CreateRotation(m_Rotation) };
+			m_Matrix.axisX = rotation.axisX * m_Scale.x;
+			m_Matrix.axisY = rotation.axisY * m_Scale.y;
+			m_Matrix.axisZ = rotation.axisZ * m_Scale.z;
+			m_Matrix.translation = m_Translation;
+
+			m_DirtyFlags &= ~Dirty_Matrix;
+		}
+		return m_Matrix;
+	}
+
+	const AffineMatrix& Transform::GetInverse()
+	{
+		if (m_DirtyFlags & Dirty_Inverse)
+		{
+			m_Inverse = GetMatrix().Inverse();
+			m_DirtyFlags &= ~Dirty_Inverse;
+		}
+		return m_Inverse;
+	}
+
+	const AffineMatrix& Transform::GetNormalMatrix()
+	{
+		if (m_DirtyFlags & Dirty_Normal)
+		{
+			m_NormalMatrix = GetMatrix().InverseTranspose();
+			m_DirtyFlags &= ~Dirty_Normal;
+		}
+		return m_NormalMatrix;
+	}
+#pragma endregion
+}
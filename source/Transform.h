@@ -0,0 +1,84 @@
+#pragma once
+#include <cstdint>
+
+#include "Vector3.h"
+
+namespace dae
+{
+	struct Matrix;
+
+	//Compact affine 3x4 matrix, same row-vector convention as Matrix
+	//p' = p.x * axisX + p.y * axisY + p.z * axisZ + translation
+	struct AffineMatrix
+	{
+		AffineMatrix() = default;
+		AffineMatrix(const Vector3& xAxis, const Vector3& yAxis, const Vector3& zAxis, const Vector3& t);
+		explicit AffineMatrix(const Matrix& m);
+
+		Vector3 TransformVector(const Vector3& v) const;
+		Vector3 TransformPoint(const Vector3& p) const;
+		Vector3 TransformPoint(float x, float y, float z) const;
+
+		float Determinant() const;
+		AffineMatrix Inverse() const;
+		AffineMatrix InverseTranspose() const; //linear part only, used to transform normals
+
+		Matrix ToMatrix() const;
+
+		//this * m >> first apply this, then m (same order as Matrix)
+		AffineMatrix operator*(const AffineMatrix& m) const;
+
+		Vector3 axisX{ 1.f, 0.f, 0.f };
+		Vector3 axisY{ 0.f, 1.f, 0.f };
+		Vector3 axisZ{ 0.f, 0.f, 1.f };
+		Vector3 translation{ 0.f, 0.f, 0.f };
+	};
+
+	//Scale > Rotation > Translation transform that caches its composed matrix,
+	//the inverse and the normal matrix (inverse-transpose). Each cache is only
+	//rebuilt when requested after one of the components changed.
+	class Transform final
+	{
+	public:
+		Transform() = default;
+
+		void SetTranslation(const Vector3& translation);
+		void SetRotation(const Vector3& pitchYawRoll);
+		void SetRotationY(float yaw);
+		void SetScale(const Vector3& scale);
+
+		const Vector3& GetTranslation() const { return m_Translation; }
+		const Vector3& GetRotation() const { return m_Rotation; }
+		const Vector3& GetScale() const { return m_Scale; }
+
+		//Incremented every time a component actually changes
+		uint32_t GetVersion() const { return m_Version; }
+
+		const AffineMatrix& GetMatrix();
+		const AffineMatrix& GetInverse();
+		const AffineMatrix& GetNormalMatrix();
+
+	private:
+		enum DirtyFlags : unsigned char
+		{
+			Dirty_None = 0,
+			Dirty_Matrix = 1 << 0,
+			Dirty_Inverse = 1 << 1,
+			Dirty_Normal = 1 << 2,
+			Dirty_All = Dirty_Matrix | Dirty_Inverse | Dirty_Normal
+		};
+
+		Vector3 m_Translation{ 0.f, 0.f, 0.f };
+		Vector3 m_Rotation{ 0.f, 0.f, 0.f }; //pitch, yaw, roll (radians)
+		Vector3 m_Scale{ 1.f, 1.f, 1.f };
+
+		AffineMatrix m_Matrix{};
+		AffineMatrix m_Inverse{};
+		AffineMatrix m_NormalMatrix{};
+
+		unsigned char m_DirtyFlags{ Dirty_None };
+		uint32_t m_Version{ 0 };
+
+		void MarkDirty();
+	};
+}
@@ -37,6 +37,11 @@ namespace dae
 				hitRecord.didHit = true;
 				hitRecord.materialIndex = sphere.materialIndex; //gives to the pixel the material of the object it hits
 				hitRecord.normal = (hitRecord.origin - sphere.origin) / sphere.radius;
+
+				//Spherical mapping, u spans the circumference (2 PI r) and v half of it
+				hitRecord.u = 0.5f + atan2f(hitRecord.normal.z, hitRecord.normal.x) / PI_2;
+				hitRecord.v = acosf(std::clamp(hitRecord.normal.y, -1.f, 1.f)) / PI;
+				hitRecord.uvDensity = 1.f / (PI * sphere.radius * 1.41421356f); //sqrt(2)
 				return true;
 			}
 
@@ -66,6 +71,14 @@ namespace dae
 				hitRecord.didHit = true;
 				hitRecord.materialIndex = plane.materialIndex; //gives to the pixel the material of the object it hits
 				hitRecord.normal = plane.normal;
+
+				//Planar mapping in the plane's tangent frame
+				Vector3 tangent{}, bitangent{};
+				Sampling::CreateOrthonormalBasis(plane.normal, tangent, bitangent);
+				const Vector3 offset{ hitRecord.origin - plane.origin };
+				hitRecord.uvDensity = 1.f / plane.uvScale;
+				hitRecord.u = Vector3::Dot(offset, tangent) * hitRecord.uvDensity;
+				hitRecord.v = Vector3::Dot(offset, bitangent) * hitRecord.uvDensity;
 				return true;
 			}
 			return false;
@@ -145,6 +158,11 @@ namespace dae
 			hitRecord.normal = triangle.normal;
 			hitRecord.origin = ray.origin + ray.direction * t;
 
+			//Barycentrics as texture coordinates (area 1/2), a = -2 * area * dot(normal, direction)
+			hitRecord.u = u;
+			hitRecord.v = v;
+			hitRecord.uvDensity = sqrtf(std::abs(dotNV / a));
+
 			return true;
 		}
 	
@@ -187,19 +205,41 @@ namespace dae
 				return false;
 
 			bool result{ false };
+			size_t hitIndex{ 0 }; //first index of the closest triangle
 			Triangle triangle{};
 			triangle.cullMode = mesh.cullMode;
 			triangle.materialIndex = mesh.materialIndex;
 
 			for (size_t i = 0; i < mesh.indices.size(); ++i)
 			{
+				const size_t firstIndex{ i };
 				triangle.normal = mesh.transformedNormals[i/3];
 				triangle.v0 = mesh.transformedPositions[mesh.indices[i]];
 				triangle.v1 = mesh.transformedPositions[mesh.indices[++i]];
 				triangle.v2 = mesh.transformedPositions[mesh.indices[++i]];			
 
 				if (HitTest_Triangle(triangle, ray, hitRecord, ignoreHitRecord)) //check if triangle hits
+				{
 					result = true;
+					hitIndex = firstIndex;
+				}
+			}
+
+			//Interpolated texture coordinates, only for the closest triangle
+			if (result && !ignoreHitRecord && !mesh.texCoords.empty())
+			{
+				const int i0{ mesh.indices[hitIndex] }, i1{ mesh.indices[hitIndex + 1] }, i2{ mesh.indices[hitIndex + 2] };
+				const float u0{ mesh.texCoords[i0 * 2] }, v0{ mesh.texCoords[i0 * 2 + 1] };
+				const float u1{ mesh.texCoords[i1 * 2] }, v1{ mesh.texCoords[i1 * 2 + 1] };
+				const float u2{ mesh.texCoords[i2 * 2] }, v2{ mesh.texCoords[i2 * 2 + 1] };
+				const float b1{ hitRecord.u }, b2{ hitRecord.v };
+
+				hitRecord.u = u0 + (u1 - u0) * b1 + (u2 - u0) * b2;
+				hitRecord.v = v0 + (v1 - v0) * b1 + (v2 - v0) * b2;
+
+				//Barycentric density scaled by the texture space area (barycentric area is 1/2)
+				const float texCoordArea{ 0.5f * std::abs((u1 - u0) * (v2 - v0) - (u2 - u0) * (v1 - v0)) };
+				hitRecord.uvDensity *= sqrtf(2.f * texCoordArea);
 			}
 	
 			return result;
@@ -231,7 +271,188 @@ namespace dae
 			else
 			{
 				float distanceSquared = (light.origin - target).SqrMagnitude();
-				return light.color * (light.intensity / distanceSquared);
+				if (light.influenceRadius == FLT_MAX)
+					return light.color * (light.intensity / distanceSquared);
+
+				if (distanceSquared >= light.influenceRadius * light.influenceRadius)
+					return {};
+
+				//Smooth window so the light fades out at its influence radius instead of cutting off
+				const float ratio4{ Square(distanceSquared / (light.influenceRadius * light.influenceRadius)) };
+				const float window{ Square(1.f - ratio4) };
+				return light.color * (light.intensity * window / distanceSquared);
+			}
+		}
+
+		/**
+		 * \brief Distance at which the unwindowed inverse square radiance of a point light drops below a threshold
+		 * \param light point light
+		 * \param threshold radiance (luminance) that is considered negligible, 0 keeps the light unbounded
+		 */
+		inline float GetInfluenceRadius(const Light& light, float threshold)
+		{
+			if (light.type == LightType::Directional || threshold <= 0.f)
+				return FLT_MAX;
+
+			return sqrtf(light.intensity * light.color.Luminance() / threshold);
+		}
+
+		//Light arriving at a shading point from one (sampled) point of a light
+		struct IncidentLight
+		{
+			Vector3 direction{}; //normalized, from the shading point to the light
+			float distance{ 0.f };
+			ColorRGB radiance{}; //already divided by the sampling pdf, black if the sample can't contribute
+			float pdf{ 0.f }; //solid angle pdf of the sample, 0 for point and directional lights (delta distributions)
+		};
+
+		/**
+		 * \brief Picks a point on the light as seen from target
+		 * \param u, v uniform samples in [0, 1), ignored by point and directional lights
+		 */
+		inline IncidentLight SampleLight(const Light& light, const Vector3& target, float u, float v)
+		{
+			IncidentLight incident{};
+			switch (light.type)
+			{
+			case LightType::Point:
+			case LightType::Directional:
+				incident.direction = GetDirectionToLight(light, target);
+				incident.distance = incident.direction.Normalize();
+				incident.radiance = GetRadiance(light, target);
+				break;
+
+			case LightType::Rectangle:
+			case LightType::Disk:
+			{
+				//Uniform over the area, radiance * cos(light) * area / distance^2
+				Vector3 point{};
+				float area{};
+				if (light.type == LightType::Rectangle)
+				{
+					point = light.origin + light.axisU * (2.f * u - 1.f) + light.axisV * (2.f * v - 1.f);
+					area = 4.f * light.axisU.Magnitude() * light.axisV.Magnitude();
+				}
+				else
+				{
+					Vector3 tangent{}, bitangent{};
+					Sampling::CreateOrthonormalBasis(light.direction, tangent, bitangent);
+					float x{}, y{};
+					Sampling::ConcentricSampleDisk(u, v, x, y);
+					point = light.origin + tangent * (x * light.radius) + bitangent * (y * light.radius);
+					area = PI * light.radius * light.radius;
+				}
+
+				incident.direction = point - target;
+				incident.distance = incident.direction.Normalize();
+				const float cosLight{ -Vector3::Dot(light.direction, incident.direction) };
+				if (cosLight > 0.f && incident.distance > 0.f) //single sided
+				{
+					incident.pdf = incident.distance * incident.distance / (cosLight * area);
+					incident.radiance = light.color * (light.intensity / incident.pdf);
+				}
+				break;
+			}
+
+			case LightType::Sphere:
+			{
+				//Uniform inside the cone the sphere subtends, radiance * solid angle
+				Vector3 toCenter{ light.origin - target };
+				const float centerDistance{ toCenter.Normalize() };
+				if (centerDistance <= light.radius)
+					break;
+
+				const float sinMaxSquared{ Square(light.radius / centerDistance) };
+				const float cosMax{ sqrtf(std::max(0.f, 1.f - sinMaxSquared)) };
+				const float cosTheta{ 1.f - u * (1.f - cosMax) };
+				const float sinTheta{ sqrtf(std::max(0.f, 1.f - cosTheta * cosTheta)) };
+				const float phi{ PI_2 * v };
+
+				Vector3 tangent{}, bitangent{};
+				Sampling::CreateOrthonormalBasis(toCenter, tangent, bitangent);
+				incident.direction = tangent * (sinTheta * cosf(phi)) + bitangent * (sinTheta * sinf(phi)) + toCenter * cosTheta;
+
+				//Distance to the near side of the sphere along the sampled direction
+				const float projected{ centerDistance * cosTheta };
+				incident.distance = projected - sqrtf(std::max(0.f, light.radius * light.radius - Square(centerDistance * sinTheta)));
+				incident.pdf = 1.f / (PI_2 * (1.f - cosMax));
+				incident.radiance = light.color * (light.intensity / incident.pdf);
+				break;
+			}
+			}
+			return incident;
+		}
+
+		/**
+		 * \brief Intersects the emitting surface of an area light
+		 * \param t distance along the ray (out)
+		 * \return emitted radiance towards the ray origin, black if the light is missed or seen from the back
+		 */
+		inline ColorRGB HitTest_AreaLight(const Light& light, const Ray& ray, float& t)
+		{
+			if (light.type == LightType::Sphere)
+			{
+				const Vector3 toCenter{ light.origin - ray.origin };
+				const float projected{ Vector3::Dot(toCenter, ray.direction) };
+				const float discriminant{ light.radius * light.radius - (toCenter.SqrMagnitude() - projected * projected) };
+				if (discriminant < 0.f)
+					return {};
+
+				t = projected - sqrtf(discriminant);
+				if (t < ray.min || t > ray.max)
+					return {};
+				return light.color * light.intensity;
+			}
+
+			if (light.type != LightType::Rectangle && light.type != LightType::Disk)
+				return {};
+
+			//Single sided, only hit from the emitting side
+			const float dotDirection{ Vector3::Dot(light.direction, ray.direction) };
+			if (dotDirection >= 0.f)
+				return {};
+
+			t = Vector3::Dot(light.origin - ray.origin, light.direction) / dotDirection;
+			if (t < ray.min || t > ray.max)
+				return {};
+
+			const Vector3 offset{ ray.origin + ray.direction * t - light.origin };
+			if (light.type == LightType::Rectangle)
+			{
+				if (std::abs(Vector3::Dot(offset, light.axisU)) > light.axisU.SqrMagnitude()
+					|| std::abs(Vector3::Dot(offset, light.axisV)) > light.axisV.SqrMagnitude())
+					return {};
+			}
+			else if (offset.SqrMagnitude() > light.radius * light.radius)
+				return {};
+
+			return light.color * light.intensity;
+		}
+
+		//Solid angle pdf with which SampleLight picks the point hit at distance t along direction from target
+		inline float GetLightPdf(const Light& light, const Vector3& target, const Vector3& direction, float t)
+		{
+			switch (light.type)
+			{
+			case LightType::Rectangle:
+			case LightType::Disk:
+			{
+				const float area{ light.type == LightType::Rectangle ?
+					4.f * light.axisU.Magnitude() * light.axisV.Magnitude() :
+					PI * light.radius * light.radius };
+				const float cosLight{ -Vector3::Dot(light.direction, direction) };
+				return cosLight > 0.f ? t * t / (cosLight * area) : 0.f;
+			}
+			case LightType::Sphere:
+			{
+				const float centerDistance{ (light.origin - target).Magnitude() };
+				if (centerDistance <= light.radius)
+					return 0.f;
+				const float cosMax{ sqrtf(std::max(0.f, 1.f - Square(light.radius / centerDistance))) };
+				return 1.f / (PI_2 * (1.f - cosMax));
+			}
+			default:
+				return 0.f;
 			}
 		}
 	}
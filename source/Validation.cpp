@@ -0,0 +1,374 @@
+#include "Validation.h"
+
+#include <chrono>
+#include <iostream>
+#include <numbers>
+#include <random>
+#include <type_traits>
+#include <vector>
+
+#include "CameraRayTable.h"
+#include "DFGTable.h"
+#include "Material.h"
+
+namespace dae {
+namespace Validation {
+
+#pragma region Helpers
+	//Uniform direction on the hemisphere around +z, tilted towards the horizon as often as towards the normal
+	static Vector3 RandomDirection(std::mt19937& generator, bool isUpperHemisphere)
+	{
+		std::uniform_real_distribution<float> distribution{ 0.f, 1.f };
+		const float cosTheta{ isUpperHemisphere ? distribution(generator) : 2.f * distribution(generator) - 1.f };
+		const float sinTheta{ sqrtf(std::max(0.f, 1.f - cosTheta * cosTheta)) };
+		const float phi{ PI_2 * distribution(generator) };
+		return { sinTheta * cosf(phi), sinTheta * sinf(phi), cosTheta };
+	}
+
+	//Analytic Cook-Torrance (same terms as Material_CookTorrence) in double precision, red channel
+	static double ShadeReference(const Vector3& normal, const Vector3& l, const Vector3& v, double albedo, bool isMetal, double roughness)
+	{
+		double halfVector[3]{ double(v.x) + l.x, double(v.y) + l.y, double(v.z) + l.z };
+		const double halfLength{ sqrt(halfVector[0] * halfVector[0] + halfVector[1] * halfVector[1] + halfVector[2] * halfVector[2]) };
+		for (double& component : halfVector)
+			component /= halfLength;
+
+		const double dotNormalHalf{ std::max(0.0, normal.x * halfVector[0] + normal.y * halfVector[1] + normal.z * halfVector[2]) };
+		const double dotViewHalf{ std::max(0.0, v.x * halfVector[0] + v.y * halfVector[1] + v.z * halfVector[2]) };
+		const double dotNormalView{ double(normal.x) * v.x + double(normal.y) * v.y + double(normal.z) * v.z };
+		const double dotNormalLight{ double(normal.x) * l.x + double(normal.y) * l.y + double(normal.z) * l.z };
+
+		const double alpha{ roughness * roughness };
+		const double distribution{ dotNormalHalf * dotNormalHalf * (alpha * alpha - 1.0) + 1.0 };
+		const double normalDistribution{ alpha * alpha / (std::numbers::pi * distribution * distribution) };
+		const double k{ (alpha + 1.0) * (alpha + 1.0) / 8.0 };
+		const double geometry{ dotNormalView / (dotNormalView * (1.0 - k) + k) * dotNormalLight / (dotNormalLight * (1.0 - k) + k) };
+
+		const double f0{ isMetal ? albedo : 0.04 };
+		const double fresnel{ f0 + (1.0 - f0) * pow(1.0 - dotViewHalf, 5.0) };
+		const double diffuse{ isMetal ? 0.0 : (1.0 - fresnel) * albedo / std::numbers::pi };
+		return fresnel * normalDistribution * geometry / (4.0 * dotNormalView * dotNormalLight) + diffuse;
+	}
+
+	//Largest component difference between direction and the reference, normalized in double precision
+	static double DirectionError(const Vector3& direction, const double reference[3])
+	{
+		const double length{ sqrt(reference[0] * reference[0] + reference[1] * reference[1] + reference[2] * reference[2]) };
+		return std::max({ std::abs(direction.x - reference[0] / length), std::abs(direction.y - reference[1] / length),
+			std::abs(direction.z - reference[2] / length) });
+	}
+
+	static void PrintResult(bool isPassed, const char* name)
+	{
+		std::cout << (isPassed ? "[PASSED] " : "[FAILED] ") << name << std::endl;
+	}
+
+	//Calls shade numSamples times over the configurations, returns nanoseconds per call
+	template<typename Function>
+	static float MeasureShade(const std::vector<Vector3>& lights, const std::vector<Vector3>& views, const HitRecord& hit, const Function& shade)
+	{
+		float checksum{ 0.f }; //keeps the calls from being optimized away
+		const auto start{ std::chrono::high_resolution_clock::now() };
+		for (size_t i{ 0 }; i < lights.size(); ++i)
+		{
+			const ColorRGB color{ shade(hit, lights[i], views[i]) };
+			checksum += color.r + color.g + color.b;
+		}
+		const auto end{ std::chrono::high_resolution_clock::now() };
+
+		if (checksum == -1.f)
+			std::cout << checksum;
+		return float(std::chrono::duration<double, std::nano>(end - start).count() / double(lights.size()));
+	}
+
+	//Log-uniform in [minValue, maxValue], both > 0
+	static std::vector<float> RandomLogUniform(std::mt19937& generator, uint32_t count, double minValue, double maxValue)
+	{
+		std::uniform_real_distribution<double> distribution{ log(minValue), log(maxValue) };
+		std::vector<float> values(count);
+		for (float& value : values)
+			value = float(exp(distribution(generator)));
+		return values;
+	}
+
+	static std::vector<float> RandomUniform(std::mt19937& generator, uint32_t count, float minValue, float maxValue)
+	{
+		std::uniform_real_distribution<float> distribution{ minValue, maxValue };
+		std::vector<float> values(count);
+		for (float& value : values)
+			value = distribution(generator);
+		return values;
+	}
+
+	//Calls function(x, y) for every input pair (function(pX, pY, pOutputs) on groups of 4 when isSSE), returns nanoseconds per value
+	template<bool isSSE, typename Function>
+	static float MeasureMath(const std::vector<float>& xs, const std::vector<float>& ys, std::vector<float>& outputs, const Function& function)
+	{
+		const auto start{ std::chrono::high_resolution_clock::now() };
+		if constexpr (isSSE)
+		{
+			for (size_t i{ 0 }; i + 4 <= xs.size(); i += 4)
+				function(&xs[i], &ys[i], &outputs[i]);
+		}
+		else
+		{
+			for (size_t i{ 0 }; i < xs.size(); ++i)
+				outputs[i] = function(xs[i], ys[i]);
+		}
+		const auto end{ std::chrono::high_resolution_clock::now() };
+		return float(std::chrono::duration<double, std::nano>(end - start).count() / double(xs.size()));
+	}
+
+	/**
+	 * \brief Times the exact, fast and SSE versions of one function and checks the largest error of the approximations
+	 * \param error error(x, y, value) of one output against double precision, in the unit maxError is given in
+	 * \param sse nullptr when there is no SSE version
+	 * \return whether both approximations stay within maxError
+	 */
+	template<typename ErrorFunction, typename ExactFunction, typename FastFunction, typename SSEFunction>
+	static bool CheckMath(const char* name, const std::vector<float>& xs, const std::vector<float>& ys, float maxError,
+		const ErrorFunction& error, const ExactFunction& exact, const FastFunction& fast, const SSEFunction& sse)
+	{
+		std::vector<float> outputs(xs.size());
+		const auto maxErrorOf{ [&]()
+			{
+				double result{ 0.0 };
+				for (size_t i{ 0 }; i < xs.size(); ++i)
+					result = std::max(result, error(xs[i], ys[i], outputs[i]));
+				return result;
+			} };
+
+		const float exactTime{ MeasureMath<false>(xs, ys, outputs, exact) };
+		const float fastTime{ MeasureMath<false>(xs, ys, outputs, fast) };
+		const double fastError{ maxErrorOf() };
+
+		bool isPassed{ fastError <= maxError };
+		std::cout << name << ": max error " << fastError;
+		if constexpr (!std::is_same_v<SSEFunction, std::nullptr_t>)
+		{
+			const float sseTime{ MeasureMath<true>(xs, ys, outputs, sse) };
+			const double sseError{ maxErrorOf() };
+			isPassed = isPassed && sseError <= maxError;
+			std::cout << " (SSE " << sseError << "), exact " << exactTime << " ns, fast " << fastTime << " ns, SSE " << sseTime << " ns" << std::endl;
+		}
+		else
+		{
+			std::cout << ", exact " << exactTime << " ns, fast " << fastTime << " ns" << std::endl;
+		}
+
+		PrintResult(isPassed, name);
+		return isPassed;
+	}
+#pragma endregion
+
+	int RunBRDF(const BRDFSettings& settings)
+	{
+		int numFailed{ 0 };
+		std::mt19937 generator{ 12345 };
+		std::uniform_real_distribution<float> distribution{ 0.f, 1.f };
+
+		//1. Both float paths against the analytic BRDF in double precision, both lobes, the whole roughness range.
+		//Near the peak of smooth surfaces the float analytic path itself loses digits, so it is reported, not required
+		HitRecord hit{};
+		hit.normal = { 0.f, 0.f, 1.f };
+		const ColorRGB albedo{ 0.9f, 0.6f, 0.3f };
+
+		float maxAnalyticError{ 0.f };
+		float maxPrecomputedError{ 0.f };
+		for (uint32_t i{ 0 }; i < settings.numSamples; ++i)
+		{
+			const bool isMetal{ i % 2 == 1 };
+			const float roughness{ std::max(distribution(generator), 0.02f) };
+			const Material_CookTorrence material{ albedo, isMetal ? 1.f : 0.f, roughness };
+			const Vector3 light{ RandomDirection(generator, true) };
+			const Vector3 view{ RandomDirection(generator, true) };
+			if (light.z < 1e-3f || view.z < 1e-3f)
+				continue; //the analytic path divides by these cosines
+
+			const double reference{ ShadeReference(hit.normal, light, view, albedo.r, isMetal, roughness) };
+			const double scale{ std::max(reference, 1e-3) };
+			maxAnalyticError = std::max(maxAnalyticError, float(std::abs(material.ShadeAnalytic(hit, light, view).r - reference) / scale));
+			maxPrecomputedError = std::max(maxPrecomputedError, float(std::abs(material.ShadePrecomputed(hit, light, view).r - reference) / scale));
+		}
+
+		const bool isShadeAccurate{ maxPrecomputedError <= settings.maxRelativeError };
+		std::cout << "Cook-Torrance max relative error: precomputed " << maxPrecomputedError << ", analytic " << maxAnalyticError << std::endl;
+		PrintResult(isShadeAccurate, "Cook-Torrance shading");
+		numFailed += isShadeAccurate ? 0 : 1;
+
+		//2. DFG table between its texels against a fresh integration with many more samples
+		const DFGTable& table{ DFGTable::Get() };
+		float maxTableError{ 0.f };
+		for (int i{ 0 }; i < 256; ++i)
+		{
+			const float dotNormalView{ std::max(distribution(generator), 0.02f) };
+			const float roughness{ std::max(distribution(generator), 0.05f) };
+
+			float scale{}, bias{}, referenceScale{}, referenceBias{};
+			table.Lookup(dotNormalView, roughness, scale, bias);
+			DFGTable::Integrate(dotNormalView, roughness, 16384, referenceScale, referenceBias);
+			maxTableError = std::max({ maxTableError, std::abs(scale - referenceScale), std::abs(bias - referenceBias) });
+		}
+
+		const bool isTableAccurate{ maxTableError <= settings.maxTableError };
+		std::cout << "DFG table: max absolute error " << maxTableError << std::endl;
+		PrintResult(isTableAccurate, "DFG table");
+		numFailed += isTableAccurate ? 0 : 1;
+
+		//3. Cost per shading call
+		std::vector<Vector3> lights(settings.numSamples);
+		std::vector<Vector3> views(settings.numSamples);
+		for (uint32_t i{ 0 }; i < settings.numSamples; ++i)
+		{
+			lights[i] = RandomDirection(generator, true);
+			views[i] = RandomDirection(generator, true);
+		}
+
+		const Material_CookTorrence dielectric{ albedo, 0.f, 0.5f };
+		const float analyticTime{ MeasureShade(lights, views, hit,
+			[&](const HitRecord& h, const Vector3& l, const Vector3& v) { return dielectric.ShadeAnalytic(h, l, v); }) };
+		const float precomputedTime{ MeasureShade(lights, views, hit,
+			[&](const HitRecord& h, const Vector3& l, const Vector3& v) { return dielectric.ShadePrecomputed(h, l, v); }) };
+		std::cout << "Shade: analytic " << analyticTime << " ns, precomputed " << precomputedTime << " ns ("
+			<< analyticTime / std::max(precomputedTime, 1e-3f) << "x)" << std::endl;
+
+		return numFailed;
+	}
+
+	int RunFastMath(const FastMathSettings& settings)
+	{
+		int numFailed{ 0 };
+		std::mt19937 generator{ 12345 };
+		const uint32_t count{ (settings.numSamples + 3) / 4 * 4 };
+		const std::vector<float> zeros(count, 0.f);
+
+		const auto relativeError{ [](double value, double reference) { return std::abs(value - reference) / std::abs(reference); } };
+
+		//Vector lengths of anything from tiny offsets to scene extents
+		const std::vector<float> rsqrtInputs{ RandomLogUniform(generator, count, 1e-30, 1e30) };
+		numFailed += CheckMath("RSqrt", rsqrtInputs, zeros, settings.maxRSqrtError,
+			[&](float x, float, float value) { return relativeError(value, 1.0 / sqrt(double(x))); },
+			[](float x, float) { return 1.f / sqrtf(x); },
+			[](float x, float) { return FastMath::RSqrtFast(x); },
+#if defined(FASTMATH_SSE)
+			[](const float* pX, const float*, float* pOutputs) { _mm_storeu_ps(pOutputs, FastMath::RSqrtFast(_mm_loadu_ps(pX))); }
+#else
+			nullptr
+#endif
+			) ? 0 : 1;
+
+		//The whole range that stays a normal float
+		const std::vector<float> exp2Inputs{ RandomUniform(generator, count, -126.f, 127.4f) };
+		numFailed += CheckMath("Exp2", exp2Inputs, zeros, settings.maxExp2Error,
+			[&](float x, float, float value) { return relativeError(value, exp2(double(x))); },
+			[](float x, float) { return exp2f(x); },
+			[](float x, float) { return FastMath::Exp2Fast(x); },
+#if defined(FASTMATH_SSE)
+			[](const float* pX, const float*, float* pOutputs) { _mm_storeu_ps(pOutputs, FastMath::Exp2Fast(_mm_loadu_ps(pX))); }
+#else
+			nullptr
+#endif
+			) ? 0 : 1;
+
+		const std::vector<float> log2Inputs{ RandomLogUniform(generator, count, 1e-37, 1e37) };
+		numFailed += CheckMath("Log2", log2Inputs, zeros, settings.maxLog2Error,
+			[](float x, float, float value)
+			{
+				const double reference{ log2(double(x)) };
+				return std::abs(value - reference) / std::max(1.0, std::abs(reference));
+			},
+			[](float x, float) { return log2f(x); },
+			[](float x, float) { return FastMath::Log2Fast(x); },
+#if defined(FASTMATH_SSE)
+			[](const float* pX, const float*, float* pOutputs) { _mm_storeu_ps(pOutputs, FastMath::Log2Fast(_mm_loadu_ps(pX))); }
+#else
+			nullptr
+#endif
+			) ? 0 : 1;
+
+		//Phong: cosines with the exponents materials use, results below 1e-30 are not visible and skipped
+		const std::vector<float> powBases{ RandomUniform(generator, count, 1e-6f, 1.f) };
+		const std::vector<float> powExponents{ RandomUniform(generator, count, 0.5f, 256.f) };
+		numFailed += CheckMath("Pow", powBases, powExponents, settings.maxPowError,
+			[&](float x, float y, float value)
+			{
+				const double reference{ pow(double(x), double(y)) };
+				if (reference < 1e-30)
+					return 0.0;
+				return relativeError(value, reference) / (1.0 + std::abs(y * log2(double(x))));
+			},
+			[](float x, float y) { return powf(x, y); },
+			[](float x, float y) { return FastMath::PowFast(x, y); },
+#if defined(FASTMATH_SSE)
+			[](const float* pX, const float* pY, float* pOutputs) { _mm_storeu_ps(pOutputs, FastMath::PowFast(_mm_loadu_ps(pX), _mm_loadu_ps(pY))); }
+#else
+			nullptr
+#endif
+			) ? 0 : 1;
+
+		//Schlick's (1 - cos)^5
+		const std::vector<float> powIntInputs{ RandomUniform(generator, count, 1e-6f, 1.f) };
+		numFailed += CheckMath("PowInt<5>", powIntInputs, zeros, settings.maxPowIntError,
+			[&](float x, float, float value) { return relativeError(value, pow(double(x), 5.0)); },
+			[](float x, float) { return powf(x, 5.f); },
+			[](float x, float) { return FastMath::PowInt<5>(x); },
+			nullptr) ? 0 : 1;
+
+		std::cout << "Shading code uses the " << (MATH_PRECISION == MathPrecision::Fast ? "fast" : "exact") << " versions (DAE_EXACT_MATH)" << std::endl;
+		return numFailed;
+	}
+
+	int RunCameraRays(const CameraRaySettings& settings)
+	{
+		std::mt19937 generator{ 12345 };
+		std::uniform_real_distribution<float> distribution{ 0.f, 1.f };
+
+		const float fov{ tanf(settings.fovAngle * TO_RADIANS / 2.f) };
+		const float aspectRatio{ float(settings.width) / float(settings.height) };
+
+		CameraRayTable table{};
+		double maxCenterError{ 0.0 };
+		double maxJitteredError{ 0.0 };
+		for (uint32_t i{ 0 }; i < settings.numOrientations; ++i)
+		{
+			//Same basis as Camera::CalculateCameraToWorld
+			Vector3 forward{ RandomDirection(generator, false) };
+			if (std::abs(forward.y) > 0.99f)
+				forward = Vector3::UnitZ;
+			const Vector3 right{ Vector3::Cross(Vector3::UnitY, forward).Normalized() };
+			const Vector3 up{ Vector3::Cross(forward, right).Normalized() };
+			table.Update(settings.width, settings.height, fov, aspectRatio, right, up, forward);
+
+			for (int py{ 0 }; py < settings.height; ++py)
+			{
+				for (int px{ 0 }; px < settings.width; ++px)
+				{
+					const uint32_t pixelIdx{ uint32_t(py * settings.width + px) };
+					const float jitterX{ distribution(generator) };
+					const float jitterY{ distribution(generator) };
+
+					//The per pixel setup: x = (2 * (px + jitterX) / width - 1) * aspectRatio * fov, through cameraToWorld
+					const auto reference{ [&](double offsetX, double offsetY, double direction[3])
+						{
+							const double x{ (2.0 * (px + offsetX) / settings.width - 1.0) * aspectRatio * fov };
+							const double y{ (1.0 - 2.0 * (py + offsetY) / settings.height) * fov };
+							for (int axis{ 0 }; axis < 3; ++axis)
+								direction[axis] = x * right[axis] + y * up[axis] + double(forward[axis]);
+						} };
+
+					double center[3]{}, jittered[3]{};
+					reference(0.5, 0.5, center);
+					reference(jitterX, jitterY, jittered);
+					maxCenterError = std::max(maxCenterError, DirectionError(table.GetDirection(pixelIdx), center));
+					maxJitteredError = std::max(maxJitteredError, DirectionError(table.GetJitteredDirection(pixelIdx, jitterX, jitterY), jittered));
+				}
+			}
+		}
+
+		const bool isPassed{ maxCenterError <= settings.maxError && maxJitteredError <= settings.maxError };
+		std::cout << "Camera rays: max error center " << maxCenterError << ", jittered " << maxJitteredError << std::endl;
+		PrintResult(isPassed, "Camera ray table");
+		return isPassed ? 0 : 1;
+	}
+}
+}
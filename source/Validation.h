@@ -0,0 +1,56 @@
+#pragma once
+#include <cstdint>
+
+namespace dae
+{
+	//Accuracy checks of the approximated shading paths against their references, run headless from the command line
+	namespace Validation
+	{
+		struct BRDFSettings
+		{
+			uint32_t numSamples{ 1000000 }; //random (normal, view, light) configurations
+			float maxRelativeError{ 1e-4f }; //precomputed Cook-Torrance against the analytic BRDF in double precision
+			float maxTableError{ 0.01f }; //DFG table lookups against a fresh integration
+		};
+
+		/**
+		 * \brief Compares the precomputed and analytic Cook-Torrance evaluations with a double precision one over random configurations
+		 * and the DFG table with a high sample count integration between its texels, prints errors and timings
+		 * \return number of failed checks
+		 */
+		int RunBRDF(const BRDFSettings& settings);
+
+		struct FastMathSettings
+		{
+			uint32_t numSamples{ 1 << 20 }; //inputs per function, spread over its whole range
+			float maxRSqrtError{ 1e-6f }; //relative
+			float maxExp2Error{ 1e-6f }; //relative
+			float maxLog2Error{ 1e-6f }; //relative to max(1, |log2(x)|), absolute around x = 1
+			float maxPowError{ 1e-6f }; //relative, divided by 1 + |y * log2(x)| since the error of log2 gets scaled by y
+			float maxPowIntError{ 1e-6f }; //relative
+		};
+
+		/**
+		 * \brief Compares the FastMath approximations (scalar and SSE) with double precision over their input ranges,
+		 * prints the largest errors and the cost per value next to the standard library functions
+		 * \return number of failed checks
+		 */
+		int RunFastMath(const FastMathSettings& settings);
+
+		struct CameraRaySettings
+		{
+			int width{ 640 };
+			int height{ 480 };
+			float fovAngle{ 45.f }; //degrees
+			uint32_t numOrientations{ 16 }; //random camera bases, each one rotates the whole table
+			float maxError{ 1e-6f }; //largest component difference of the normalized directions
+		};
+
+		/**
+		 * \brief Compares the center and jittered directions of the CameraRayTable with the per pixel ray setup
+		 * (NDC through cameraToWorld, normalized) in double precision for every pixel of random camera orientations
+		 * \return number of failed checks
+		 */
+		int RunCameraRays(const CameraRaySettings& settings);
+	}
+}
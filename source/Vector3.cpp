@@ -3,6 +3,7 @@
 #include <cassert>
 
 #include "Vector4.h"
+#include "FastMath.h"
 #include <cmath>
 
 namespace dae {
@@ -39,8 +40,17 @@ namespace dae {
 
 	Vector3 Vector3::Normalized() const
 	{
-		const float m = Magnitude();
-		return { x / m, y / m, z / m };
+		//Exact builds keep the original division, bit for bit
+		if constexpr (MATH_PRECISION == MathPrecision::Fast)
+		{
+			const float invM = FastMath::RSqrtFast(SqrMagnitude());
+			return { x * invM, y * invM, z * invM };
+		}
+		else
+		{
+			const float m = Magnitude();
+			return { x / m, y / m, z / m };
+		}
 	}
 
 	float Vector3::Dot(const Vector3& v1, const Vector3& v2)
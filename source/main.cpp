@@ -5,26 +5,278 @@
 #undef main
 
 //Standard includes
+#include <algorithm>
+#include <fstream>
 #include <iostream>
+#include <numeric>
+#include <string>
+#include <vector>
 
 //Project includes
 #include "Timer.h"
 #include "Renderer.h"
 #include "Scene.h"
+#include "CameraPath.h"
+#include "Regression.h"
+#include "EnvironmentMap.h"
+#include "Validation.h"
+#include "Texture.h"
+#include "TextureCache.h"
 
 using namespace dae;
 
+//Offline animation: --animation <frames> [fps] [output.y4m | sequence base name] [--spp <samples>]
+struct AnimationSettings
+{
+	uint32_t numFrames{ 0 }; //0 >> interactive
+	uint32_t framesPerSecond{ 30 };
+	uint32_t samplesPerFrame{ 16 };
+	std::string output{ "RayTracing_Animation.y4m" };
+};
+
+//Reproducible runs: --record-path <file>, --replay-path <file>, --benchmark <frames>
+struct BenchmarkSettings
+{
+	std::string recordPath{};
+	std::string replayPath{};
+	uint32_t numFrames{ 0 }; //0 >> interactive
+	float timeStep{ 1.f / 30.f };
+};
+
+//Golden image check: --regression [directory] [--update-references]
+//Low sample previews: --denoise
+//Dynamic resolution: --frame-budget <milliseconds>
+//Variable rate tracing of moving views: --variable-rate
+//Streamed textures: --texture-budget <megabytes>, --bake-texture <image (.ppm/.pfm)> <tiled output (.tex)>
+//Environment light: --environment <latitude-longitude map (.pfm/.hdr)> [intensity]
+//Accuracy of the precomputed shading paths: --validate-brdf
+//Accuracy and cost of the fast math approximations: --validate-math
+//Camera ray table against the per pixel ray setup: --validate-camera
+struct LaunchSettings
+{
+	bool runRegression{ false };
+	RegressionSettings regression{};
+	bool denoise{ false };
+	float frameBudget{ 0.f }; //0 >> always full resolution
+	bool variableRate{ false };
+	size_t textureBudget{ 0 }; //bytes, 0 >> scene default
+	std::string bakeInput{};
+	std::string bakeOutput{};
+	std::string environment{};
+	float environmentIntensity{ 1.f };
+	bool validateBRDF{ false };
+	bool validateMath{ false };
+	bool validateCamera{ false };
+};
+
 void ShutDown(SDL_Window* pWindow)
 {
 	SDL_DestroyWindow(pWindow);
 	SDL_Quit();
 }
 
+void PrintUsage()
+{
+	std::cout << "Options:\n"
+		<< "  --animation <frames> [fps] [output.y4m | sequence base name] [--spp <samples>]\n"
+		<< "  --record-path <file>, --replay-path <file>, --benchmark <frames>\n"
+		<< "  --regression [directory] [--update-references]\n"
+		<< "  --denoise, --frame-budget <milliseconds>, --variable-rate\n"
+		<< "  --texture-budget <megabytes>, --bake-texture <image (.ppm/.pfm)> <tiled output (.tex)>\n"
+		<< "  --environment <latitude-longitude map (.pfm/.hdr)> [intensity]\n"
+		<< "  --validate-brdf, --validate-math, --validate-camera" << std::endl;
+}
+
+//False if a value could not be parsed
+bool ParseArguments(int argc, char* args[], AnimationSettings& animation, BenchmarkSettings& benchmark, LaunchSettings& launch)
+{
+	for (int i{ 1 }; i < argc; ++i)
+	{
+		const std::string argument{ args[i] };
+		try
+		{
+			if (argument == "--animation" && i + 1 < argc)
+			{
+				animation.numFrames = std::stoul(args[++i]);
+				if (i + 1 < argc && args[i + 1][0] != '-')
+					animation.framesPerSecond = std::max(1ul, std::stoul(args[++i]));
+				if (i + 1 < argc && args[i + 1][0] != '-')
+					animation.output = args[++i];
+			}
+			else if (argument == "--spp" && i + 1 < argc)
+				animation.samplesPerFrame = std::max(1ul, std::stoul(args[++i]));
+			else if (argument == "--record-path" && i + 1 < argc)
+				benchmark.recordPath = args[++i];
+			else if (argument == "--replay-path" && i + 1 < argc)
+				benchmark.replayPath = args[++i];
+			else if (argument == "--benchmark" && i + 1 < argc)
+				benchmark.numFrames = std::stoul(args[++i]);
+			else if (argument == "--regression")
+			{
+				launch.runRegression = true;
+				if (i + 1 < argc && args[i + 1][0] != '-')
+					launch.regression.directory = args[++i];
+			}
+			else if (argument == "--update-references")
+				launch.regression.updateReferences = true;
+			else if (argument == "--denoise")
+				launch.denoise = true;
+			else if (argument == "--frame-budget" && i + 1 < argc)
+				launch.frameBudget = std::stof(args[++i]);
+			else if (argument == "--variable-rate")
+				launch.variableRate = true;
+			else if (argument == "--texture-budget" && i + 1 < argc)
+				launch.textureBudget = size_t(std::stoul(args[++i])) << 20;
+			else if (argument == "--validate-brdf")
+				launch.validateBRDF = true;
+			else if (argument == "--validate-math")
+				launch.validateMath = true;
+			else if (argument == "--validate-camera")
+				launch.validateCamera = true;
+			else if (argument == "--environment" && i + 1 < argc)
+			{
+				launch.environment = args[++i];
+				if (i + 1 < argc && args[i + 1][0] != '-')
+					launch.environmentIntensity = std::stof(args[++i]);
+			}
+			else if (argument == "--bake-texture" && i + 2 < argc)
+			{
+				launch.bakeInput = args[++i];
+				launch.bakeOutput = args[++i];
+			}
+		}
+		catch (const std::exception&)
+		{
+			//std::stoul / std::stof throw on values that are not numbers or out of range
+			std::cout << "Invalid value for " << argument << std::endl;
+			PrintUsage();
+			return false;
+		}
+	}
+	return true;
+}
+
+//Renders frames at a fixed time step, the writer encodes frame N while frame N+1 is traced
+void RenderAnimation(Scene* pScene, Renderer* pRenderer, Timer* pTimer, const AnimationSettings& settings, int width, int height)
+{
+	const std::string& output{ settings.output };
+	const bool isVideo{ output.size() >= 4 && output.compare(output.size() - 4, 4, ".y4m") == 0 };
+
+	ImageWriter& writer{ pRenderer->GetImageWriter() };
+	if (isVideo)
+		writer.OpenVideo(output, width, height, settings.framesPerSecond);
+
+	//Every frame gets exactly samplesPerFrame fresh samples, no history from the previous frame
+	pRenderer->SetMaxSamples(settings.samplesPerFrame);
+	pRenderer->SetTemporalReprojection(false);
+	pTimer->SetFixedTimeStep(1.f / float(settings.framesPerSecond));
+
+	std::cout << "Rendering " << settings.numFrames << " frames to " << output << std::endl;
+	for (uint32_t frame{ 0 }; frame < settings.numFrames; ++frame)
+	{
+		SDL_Event e;
+		while (SDL_PollEvent(&e))
+		{
+			if (e.type == SDL_QUIT)
+			{
+				std::cout << "Animation cancelled at frame " << frame << std::endl;
+				frame = settings.numFrames;
+			}
+		}
+		if (frame >= settings.numFrames)
+			break;
+
+		pScene->Update(pTimer);
+
+		//Keep refining until every pixel converged or got samplesPerFrame samples
+		while (pRenderer->Render(pScene)) {}
+
+		if (isVideo)
+			writer.SubmitVideoFrame(pRenderer->CaptureImage(), true);
+		else
+			pRenderer->SaveFrameToSequence(output, frame, ImageFormat::PNG, true);
+
+		pTimer->Update();
+		std::cout << "Frame " << frame + 1 << "/" << settings.numFrames << std::endl;
+	}
+
+	if (isVideo)
+		writer.CloseVideo();
+	writer.Flush();
+	std::cout << "Animation done, " << writer.GetNumFailed() << " write(s) failed" << std::endl;
+}
+
+//Traces exactly numFrames frames on the fixed clock (and the replayed camera path if any), wall time per frame goes to benchmark.txt
+void RunBenchmark(Scene* pScene, Renderer* pRenderer, Timer* pTimer, const BenchmarkSettings& settings)
+{
+	std::vector<float> frameTimes{};
+	frameTimes.reserve(settings.numFrames);
+
+	std::cout << "**BENCHMARK STARTED** (" << settings.numFrames << " frames)\n";
+	for (uint32_t frame{ 0 }; frame < settings.numFrames; ++frame)
+	{
+		SDL_Event e;
+		while (SDL_PollEvent(&e))
+		{
+			if (e.type == SDL_QUIT)
+				return;
+		}
+
+		const uint64_t startTime{ SDL_GetPerformanceCounter() };
+		pScene->Update(pTimer);
+		pRenderer->Render(pScene);
+		const uint64_t endTime{ SDL_GetPerformanceCounter() };
+
+		frameTimes.emplace_back(float(double(endTime - startTime) / double(SDL_GetPerformanceFrequency())));
+		pTimer->Update();
+	}
+
+	if (frameTimes.empty())
+		return;
+
+	const float totalTime{ std::accumulate(frameTimes.begin(), frameTimes.end(), 0.f) };
+	const float slowestFrame{ *std::max_element(frameTimes.begin(), frameTimes.end()) };
+	const float fastestFrame{ *std::min_element(frameTimes.begin(), frameTimes.end()) };
+
+	std::cout << "**BENCHMARK FINISHED**\n";
+	std::cout << ">> HIGH = " << 1.f / fastestFrame << std::endl;
+	std::cout << ">> LOW = " << 1.f / slowestFrame << std::endl;
+	std::cout << ">> AVG = " << float(frameTimes.size()) / totalTime << std::endl;
+
+	std::ofstream fileStream("benchmark.txt");
+	fileStream << "FRAMES = " << frameTimes.size() << std::endl;
+	fileStream << "HIGH = " << 1.f / fastestFrame << std::endl;
+	fileStream << "LOW = " << 1.f / slowestFrame << std::endl;
+	fileStream << "AVG = " << float(frameTimes.size()) / totalTime << std::endl;
+	for (size_t i{ 0 }; i < frameTimes.size(); ++i)
+		fileStream << "FRAME " << i << " = " << frameTimes[i] * 1000.f << " ms" << std::endl;
+}
+
 int main(int argc, char* args[])
 {
-	//Unreferenced parameters
-	(void)argc;
-	(void)args;
+	AnimationSettings animation{};
+	BenchmarkSettings benchmark{};
+	LaunchSettings launch{};
+	if (!ParseArguments(argc, args, animation, benchmark, launch))
+		return 1;
+
+	//Headless accuracy check, the exit code is the number of failed checks
+	if (launch.validateBRDF)
+		return Validation::RunBRDF({});
+	if (launch.validateMath)
+		return Validation::RunFastMath({});
+	if (launch.validateCamera)
+		return Validation::RunCameraRays({});
+
+	//Offline conversion to the tiled format, no window needed
+	if (!launch.bakeInput.empty())
+	{
+		Texture* pTexture{ Texture::LoadFromFile(launch.bakeInput) };
+		const bool isBaked{ pTexture && pTexture->WriteTiled(launch.bakeOutput) };
+		std::cout << (isBaked ? "Baked " : "Failed to bake ") << launch.bakeInput << " >> " << launch.bakeOutput << std::endl;
+		delete pTexture;
+		return isBaked ? 0 : 1;
+	}
 
 	//Create window + surfaces
 	SDL_Init(SDL_INIT_VIDEO);
@@ -36,24 +288,104 @@ int main(int argc, char* args[])
 		"RayTracer - Arianna Lopreiato",
 		SDL_WINDOWPOS_UNDEFINED,
 		SDL_WINDOWPOS_UNDEFINED,
-		width, height, 0);
+		width, height, launch.runRegression ? SDL_WINDOW_HIDDEN : 0);
 
 	if (!pWindow)
 		return 1;
 
+	//Headless regression run, the exit code is the number of failed scenes
+	if (launch.runRegression)
+	{
+		const int numFailed{ Regression::Run(pWindow, launch.regression) };
+		ShutDown(pWindow);
+		return numFailed;
+	}
+
 	//Initialize "framework"
 	const auto pTimer = new Timer();
 	const auto pRenderer = new Renderer(pWindow);
+	pRenderer->SetDenoiser(launch.denoise);
+	if (launch.frameBudget > 0.f)
+		pRenderer->SetFrameTimeBudget(launch.frameBudget);
+	pRenderer->SetVariableRate(launch.variableRate);
 
 	const auto pScene = new Scene_W4_BunnyScene();
 	//const auto pScene = new Scene_W4_ReferenceScene();
+	//const auto pScene = new Scene_Textures("Resources/floor.tex"); //streams a floor baked with --bake-texture
+	if (launch.textureBudget > 0)
+		pScene->SetTextureBudget(launch.textureBudget);
 	pScene->Initialize();
+	if (!launch.environment.empty())
+	{
+		EnvironmentMap* pEnvironment{ EnvironmentMap::LoadFromFile(launch.environment, launch.environmentIntensity) };
+		if (pEnvironment)
+			pScene->SetEnvironment(pEnvironment);
+		else
+			std::cout << "Failed to load environment " << launch.environment << std::endl;
+	}
+
+	//Offline animation instead of the interactive loop
+	if (animation.numFrames > 0)
+	{
+		pTimer->Start();
+		RenderAnimation(pScene, pRenderer, pTimer, animation, width, height);
+		pTimer->Stop();
+
+		delete pScene;
+		delete pRenderer;
+		delete pTimer;
+
+		ShutDown(pWindow);
+		return 0;
+	}
+
+	//Recorded camera input, replaying it on the fixed clock traces the same rays every run
+	CameraPath cameraPath{};
+	if (!benchmark.replayPath.empty())
+	{
+		if (cameraPath.Load(benchmark.replayPath))
+		{
+			cameraPath.StartReplay(pScene->GetCamera());
+			pTimer->SetFixedTimeStep(benchmark.timeStep);
+			std::cout << "Replaying " << cameraPath.GetNumFrames() << " frames from " << benchmark.replayPath << std::endl;
+		}
+		else
+			std::cout << "Failed to load camera path " << benchmark.replayPath << std::endl;
+	}
+	else if (!benchmark.recordPath.empty())
+	{
+		cameraPath.StartRecording(pScene->GetCamera());
+		pTimer->SetFixedTimeStep(benchmark.timeStep);
+		std::cout << "Recording camera path to " << benchmark.recordPath << std::endl;
+	}
+
+	if (benchmark.numFrames > 0)
+	{
+		//Without a path the camera ignores the live input, the frames must not depend on the mouse
+		if (cameraPath.GetMode() != CameraPath::Mode::Replaying)
+			pScene->GetCamera().processInput = [](const CameraInput&) { return CameraInput{}; };
+		pTimer->SetFixedTimeStep(benchmark.timeStep);
+
+		pTimer->Start();
+		RunBenchmark(pScene, pRenderer, pTimer, benchmark);
+		pTimer->Stop();
+
+		delete pScene;
+		delete pRenderer;
+		delete pTimer;
+
+		ShutDown(pWindow);
+		return 0;
+	}
 
 	//Start loop
 	pTimer->Start();
 	float printTimer = 0.f;
 	bool isLooping = true;
 	bool takeScreenshot = false;
+	bool takeHDRScreenshot = false;
+	bool isRecording = false;
+	uint32_t recordedFrames = 0;
 	while (isLooping)
 	{
 		//--------- Get input events ---------
@@ -69,10 +401,43 @@ int main(int argc, char* args[])
 			case SDL_KEYUP:
 				if(e.key.keysym.scancode == SDL_SCANCODE_X)
 					takeScreenshot = true;
+				if (e.key.keysym.scancode == SDL_SCANCODE_C)
+					takeHDRScreenshot = true;
+				if (e.key.keysym.scancode == SDL_SCANCODE_R)
+				{
+					isRecording = !isRecording;
+					std::cout << (isRecording ? "Recording frames..." : "Recording stopped") << std::endl;
+				}
 				if (e.key.keysym.scancode == SDL_SCANCODE_F2)
 					pRenderer->ToggleShadows();
 				if (e.key.keysym.scancode == SDL_SCANCODE_F3)
 					pRenderer->CycleLightMode();
+				if (e.key.keysym.scancode == SDL_SCANCODE_F4)
+					pRenderer->ToggleProgressive();
+				if (e.key.keysym.scancode == SDL_SCANCODE_F5)
+					pRenderer->ToggleAdaptiveSampling();
+				if (e.key.keysym.scancode == SDL_SCANCODE_F7)
+					pRenderer->CycleDisplayMode();
+				if (e.key.keysym.scancode == SDL_SCANCODE_F8)
+					pRenderer->CycleToneMapper();
+				if (e.key.keysym.scancode == SDL_SCANCODE_F9)
+					pRenderer->ToggleSRGB();
+				if (e.key.keysym.scancode == SDL_SCANCODE_F10)
+					pRenderer->ToggleManyLightSampling();
+				if (e.key.keysym.scancode == SDL_SCANCODE_F11)
+					pRenderer->ToggleLightCulling();
+				if (e.key.keysym.scancode == SDL_SCANCODE_P)
+					pRenderer->CycleIntegrator();
+				if (e.key.keysym.scancode == SDL_SCANCODE_N)
+					pRenderer->ToggleDenoiser();
+				if (e.key.keysym.scancode == SDL_SCANCODE_T)
+					pRenderer->ToggleTemporalReprojection();
+				if (e.key.keysym.scancode == SDL_SCANCODE_U)
+					pRenderer->ToggleDynamicResolution();
+				if (e.key.keysym.scancode == SDL_SCANCODE_V)
+					pRenderer->ToggleVariableRate();
+				if (e.key.keysym.scancode == SDL_SCANCODE_B)
+					pRenderer->ToggleBRDFPrecomputation();
 				if (e.key.keysym.scancode == SDL_SCANCODE_F6)
 					pTimer->StartBenchmark();
 				break;
@@ -83,7 +448,14 @@ int main(int argc, char* args[])
 		pScene->Update(pTimer);
 
 		//--------- Render ---------
-		pRenderer->Render(pScene);
+		//Nothing changed >> previous frame reused, give the CPU back instead of spinning
+		const bool isNewFrame = pRenderer->Render(pScene);
+		if (!isNewFrame)
+			SDL_Delay(1);
+
+		//Numbered PNG sequence of every traced frame, frames are dropped rather than stalling the loop
+		if (isRecording && isNewFrame)
+			pRenderer->SaveFrameToSequence("RayTracing_Frame", recordedFrames++, ImageFormat::PNG);
 
 		//--------- Timer ---------
 		pTimer->Update();
@@ -91,21 +463,73 @@ int main(int argc, char* args[])
 		if (printTimer >= 1.f)
 		{
 			printTimer = 0.f;
-			std::cout << "dFPS: " << pTimer->GetdFPS() << std::endl;
+			std::cout << "dFPS: " << pTimer->GetdFPS()
+				<< " | shadow rays traced: " << pRenderer->GetNumShadowRaysTraced()
+				<< ", skipped: " << pRenderer->GetNumShadowRaysSkipped()
+				<< " | reprojected pixels: " << pRenderer->GetNumReprojectedPixels() << std::endl;
+
+			if (pRenderer->IsDynamicResolutionEnabled())
+			{
+				std::cout << "Render scale: " << pRenderer->GetRenderScale()
+					<< " (" << pRenderer->GetRenderWidth() << "x" << pRenderer->GetRenderHeight() << ")"
+					<< " | last frame: " << pRenderer->GetLastFrameTime() << " ms" << std::endl;
+			}
+
+			if (pRenderer->IsVariableRateEnabled())
+			{
+				const uint32_t numRenderPixels{ uint32_t(pRenderer->GetRenderWidth() * pRenderer->GetRenderHeight()) };
+				std::cout << "Variable rate: " << pRenderer->GetNumInterpolatedPixels() << " of " << numRenderPixels
+					<< " pixels interpolated in the last moving frame" << std::endl;
+			}
+
+			if (TextureCache* pTextureCache{ pScene->GetTextureCache() })
+			{
+				const TextureCacheStatistics textures{ pTextureCache->GetStatistics() };
+				const uint64_t numLookups{ textures.numHits + textures.numMisses };
+				std::cout << "Texture cache: " << (numLookups > 0 ? 100.f * float(textures.numHits) / float(numLookups) : 100.f) << "% hits"
+					<< " | tiles loaded: " << textures.numLoads << ", evicted: " << textures.numEvictions
+					<< " | resident: " << (textures.residentSize >> 10) << " KB (peak " << (textures.peakResidentSize >> 10) << " KB)"
+					<< " of " << (pTextureCache->GetBudget() >> 10) << " KB" << std::endl;
+				pTextureCache->ResetStatistics();
+			}
+
+			if (pRenderer->IsPathTracing())
+			{
+				const PathStatistics paths{ pRenderer->GetPathStatistics() };
+				if (paths.numPaths > 0)
+				{
+					std::cout << "Paths: " << paths.numPaths
+						<< " | avg bounces: " << float(paths.numBounces) / float(paths.numPaths)
+						<< " | roulette terminated: " << 100.f * float(paths.numRouletteTerminations) / float(paths.numPaths) << "%"
+						<< " | bounces histogram:";
+					for (const uint32_t count : paths.pathLengths)
+						std::cout << " " << count;
+					std::cout << std::endl;
+				}
+			}
 		}
 
 		//Save screenshot after full render
-		if (takeScreenshot)
+		if (takeScreenshot || takeHDRScreenshot)
 		{
-			if (!pRenderer->SaveBufferToImage())
-				std::cout << "Screenshot saved!" << std::endl;
+			if (pRenderer->SaveBufferToImage(takeHDRScreenshot ? ImageFormat::PFM : ImageFormat::BMP))
+				std::cout << "Screenshot queued!" << std::endl;
 			else
 				std::cout << "Something went wrong. Screenshot not saved!" << std::endl;
 			takeScreenshot = false;
+			takeHDRScreenshot = false;
 		}
 	}
 	pTimer->Stop();
 
+	if (cameraPath.GetMode() == CameraPath::Mode::Recording)
+	{
+		if (cameraPath.Save(benchmark.recordPath))
+			std::cout << "Camera path saved (" << cameraPath.GetNumFrames() << " frames)" << std::endl;
+		else
+			std::cout << "Failed to save camera path " << benchmark.recordPath << std::endl;
+	}
+
 	//Shutdown "framework"
 	delete pScene;
 	delete pRenderer;